@@ -123,8 +123,13 @@ pdec
             place_t p;
             p.name = strdup($1);
             p.identifier = andl_context->num_places;
+            p.level = p.identifier;
+            p.bits = 0;
+            p.code = 0;
             p.initial_marking = $3;
 
+            if ($3 > 1) andl_context->weighted = 1;
+
             if (andl_context->num_places >= andl_context->place_buf_size - 1) {
                 andl_context->place_buf_size *= 2;
                 andl_context->places = realloc(andl_context->places, andl_context->place_buf_size * sizeof(place_t));
@@ -161,6 +166,7 @@ tdec
 
             transition_t transition;
             transition.name = strdup($1);
+            transition.identifier = andl_context->num_transitions;
             transition.num_arcs = 0;
             transition.arcs_buf_size = 16;
             transition.arcs = malloc(transition.arcs_buf_size * sizeof(arc_t));
@@ -196,14 +202,7 @@ arcs
 /* parse a single arc */
 arc
     :   LBRAC IDENT op const_function RBRAC {
-            if ($4 != 1) {
-                warn(
-                    "Not a 1-safe net."
-                    " Petri net should always produce, or consume 1 token,"
-                    " Instead, was: %d.",
-                    $4);
-                andl_context->error = 1;
-            }
+            if ($4 != 1) andl_context->weighted = 1;
             /* Here you can do something with
              * andl_context->current_trans */
             if ($3 == ARC_IN) {
@@ -215,6 +214,7 @@ arc
             // construct arc struct
             arc_t arc;
             arc.dir = $3;
+            arc.weight = $4;
 
             // find place
             int found = 0;
@@ -268,8 +268,8 @@ op
 
 const_function
     :   NUMBER {
-            if ($1 != 1) {
-                warn("This is not a 1-safe Petri net!");
+            if ($1 < 1) {
+                warn("Arc weights must be positive, was: %d", $1);
                 andl_context->error = 1;
             }
         }
@@ -20,15 +20,26 @@ typedef struct {
     char *name;
     int identifier;
     int initial_marking;
+
+    // the position of the place in the BDD variable order
+    int level;
+    // the number of levels of the one-hot group of the place, 0 if the place has a level of its
+    // own; the place is marked when the levels of its group, from level on, hold its code in binary
+    int bits;
+    int code;
 } place_t;
 
 typedef struct {
     place_t *place;
     arc_dir_t dir;
+
+    // the number of tokens the arc consumes or produces
+    int weight;
 } arc_t;
 
 typedef struct {
     char *name;
+    int identifier;
 
     arc_t *arcs;
     int num_arcs;
@@ -61,6 +72,9 @@ typedef struct {
     // whether an error has occured during parsing
     int error;
 
+    // whether an arc weight or initial marking is larger than 1, so the net need not be 1-safe
+    int weighted;
+
     place_t *places;
     int place_buf_size;
 
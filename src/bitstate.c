@@ -0,0 +1,250 @@
+#include "bitstate.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "stubborn.h"
+#include "util.h"
+
+typedef struct {
+    uint64_t *bits;
+    uint64_t num_bits;
+    uint64_t bits_set;
+    int num_hashes;
+} bit_array_t;
+
+/*
+ * Sets the bits of \p marking, at the hashes h1 + i * h2 for i up to the number of hash functions,
+ * like Kirsch and Mitzenmacher do for Bloom filters.
+ * \return: whether one of the bits was not set yet, so the marking is new.
+ */
+static int test_and_set(bit_array_t *array, const uint64_t *marking, int num_words) {
+    uint64_t h1 = explicit_hash(marking, num_words, 1);
+    uint64_t h2 = explicit_hash(marking, num_words, 2) | 1;
+    int added = 0;
+
+    for (int i = 0; i < array->num_hashes; i++) {
+        // map the hash to a bit without a division
+        uint64_t bit = (uint64_t) (((unsigned __int128) (h1 + i * h2) * array->num_bits) >> 64);
+        uint64_t mask = 1ull << (bit % 64);
+
+        if ((array->bits[bit / 64] & mask) == 0) {
+            array->bits[bit / 64] |= mask;
+            array->bits_set++;
+            added = 1;
+        }
+    }
+
+    return added;
+}
+
+/*
+ * The probability that all bits of a new marking are already set.
+ */
+static double collision_probability(uint64_t bits_set, uint64_t num_bits, int num_hashes) {
+    double filled = (double) bits_set / num_bits;
+    double p = 1;
+
+    // there are at most 64 hash functions, so this needs no pow from libm
+    for (int i = 0; i < num_hashes; i++) p *= filled;
+
+    return p;
+}
+
+double bitstate_collision_probability(bitstate_result_t *result) {
+    return collision_probability(result->bits_set, result->num_bits, result->num_hashes);
+}
+
+/*
+ * A marking on the search stack. The transitions to fire in it are fire[next] up to fire[end].
+ */
+typedef struct {
+    size_t next;
+    size_t end;
+} frame_t;
+
+/*
+ * The search stack: a frame and a marking per level, and the transitions of all frames.
+ */
+typedef struct {
+    explicit_net_t *net;
+
+    frame_t *frames;
+    uint64_t *markings;
+    size_t depth;
+    size_t capacity;
+
+    int *fire;
+    size_t fire_top;
+    size_t fire_capacity;
+
+    ctl_node_t *goal;
+    int reduce;
+    char *in_set;
+    int *closure_stack;
+} search_stack_t;
+
+/*
+ * Pushes the frame of the marking at the top of the stack, with the transitions to fire in it: the
+ * enabled transitions of a stubborn set with \p reduce, and else all enabled transitions.
+ */
+static void push_frame(search_stack_t *stack) {
+    explicit_net_t *net = stack->net;
+    const uint64_t *marking = stack->markings + stack->depth * net->num_words;
+
+    if (stack->fire_top + net->num_transitions > stack->fire_capacity) {
+        stack->fire_capacity = 2 * stack->fire_capacity + net->num_transitions;
+        stack->fire = rrealloc(stack->fire, stack->fire_capacity * sizeof(int));
+    }
+
+    int *fire = stack->fire + stack->fire_top;
+    int num_fire = 0;
+
+    if (stack->reduce) {
+        num_fire = stubborn_set(net, stack->goal, marking, stack->in_set, stack->closure_stack, fire);
+    } else {
+        for (int t = 0; t < net->num_transitions; t++) {
+            if (net->fires[t] && explicit_enabled(net, marking, t)) fire[num_fire++] = t;
+        }
+    }
+
+    stack->frames[stack->depth].next = stack->fire_top;
+    stack->frames[stack->depth].end = stack->fire_top + num_fire;
+    stack->fire_top += num_fire;
+    stack->depth++;
+}
+
+/*
+ * Makes room for the marking above the top of the stack.
+ */
+static void reserve(search_stack_t *stack) {
+    if (stack->depth + 1 < stack->capacity) return;
+
+    stack->capacity *= 2;
+    stack->frames = rrealloc(stack->frames, stack->capacity * sizeof(frame_t));
+    stack->markings = rrealloc(stack->markings, stack->capacity * stack->net->num_words * sizeof(uint64_t));
+}
+
+/*
+ * Stores the transitions that lead to the marking above the top of the stack in the trace of
+ * \p result.
+ */
+static void store_trace(search_stack_t *stack, bitstate_result_t *result) {
+    result->trace = mmalloc((stack->depth + 1) * sizeof(int));
+    result->trace_length = stack->depth;
+
+    // the transition each frame fired last is the one before its next
+    for (size_t i = 0; i < stack->depth; i++) {
+        result->trace[i] = stack->fire[stack->frames[i].next - 1];
+    }
+}
+
+void bitstate_search(explicit_net_t *net, size_t memory, int num_hashes, size_t depth_bound, ctl_node_t *goal,
+        int reduce, bitstate_result_t *result) {
+    size_t words = (size_t) net->num_words;
+
+    bit_array_t array;
+    array.num_bits = (uint64_t) memory * 8;
+    array.bits = calloc(memory / sizeof(uint64_t) + 1, sizeof(uint64_t));
+    array.bits_set = 0;
+    array.num_hashes = num_hashes;
+
+    if (array.bits == NULL) {
+        warn("Unable to allocate a bit array of %zu bytes", memory);
+        exit(1);
+    }
+
+    search_stack_t stack;
+    stack.net = net;
+    stack.capacity = 1024;
+    stack.frames = mmalloc(stack.capacity * sizeof(frame_t));
+    stack.markings = mmalloc(stack.capacity * words * sizeof(uint64_t));
+    stack.depth = 0;
+    stack.fire = NULL;
+    stack.fire_top = 0;
+    stack.fire_capacity = 0;
+    stack.goal = goal;
+    stack.reduce = reduce && goal != NULL;
+    stack.in_set = mmalloc(net->num_transitions + 1);
+    stack.closure_stack = mmalloc((net->num_transitions + 1) * sizeof(int));
+
+    memset(result, 0, sizeof(bitstate_result_t));
+    result->num_bits = array.num_bits;
+    result->num_hashes = num_hashes;
+
+    double start = wctime();
+
+    memcpy(stack.markings, net->initial, words * sizeof(uint64_t));
+    test_and_set(&array, net->initial, net->num_words);
+    result->states = 1;
+
+    if (goal != NULL && explicit_eval(net, goal, net->initial)) {
+        result->found = 1;
+        store_trace(&stack, result);
+    } else {
+        push_frame(&stack);
+        result->max_depth = 1;
+    }
+
+    while (stack.depth > 0 && !result->found) {
+        frame_t *frame = stack.frames + stack.depth - 1;
+
+        if (frame->next == frame->end) {
+            // the transitions of a frame follow those of the frame below it
+            stack.depth--;
+            stack.fire_top = stack.depth > 0 ? frame[-1].end : 0;
+            continue;
+        }
+
+        int t = stack.fire[frame->next++];
+
+        reserve(&stack);
+
+        uint64_t *marking = stack.markings + (stack.depth - 1) * words;
+        uint64_t *successor = marking + words;
+
+        explicit_fire(net, marking, t, successor);
+        result->transitions++;
+
+        uint64_t bits_set = array.bits_set;
+
+        if (!test_and_set(&array, successor, net->num_words)) continue;
+
+        result->states++;
+
+        // if every new marking is taken for a visited one with probability p, on average p / (1 - p)
+        // markings are missed for every marking that is found
+        double p = collision_probability(bits_set, array.num_bits, num_hashes);
+        if (p < 1) result->omitted += p / (1 - p);
+
+        if ((result->states & ((1 << 20) - 1)) == 0) {
+            warn("Bitstate search: %llu states, depth %zu, %.3f of the bits set",
+                    (unsigned long long) result->states, stack.depth, (double) array.bits_set / array.num_bits);
+        }
+
+        if (goal != NULL && explicit_eval(net, goal, successor)) {
+            result->found = 1;
+            store_trace(&stack, result);
+            break;
+        }
+
+        if (stack.depth == depth_bound) {
+            result->truncated++;
+            continue;
+        }
+
+        push_frame(&stack);
+
+        if (stack.depth > result->max_depth) result->max_depth = stack.depth;
+    }
+
+    result->bits_set = array.bits_set;
+    result->time = wctime() - start;
+
+    free(array.bits);
+    free(stack.frames);
+    free(stack.markings);
+    free(stack.fire);
+    free(stack.in_set);
+    free(stack.closure_stack);
+}
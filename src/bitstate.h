@@ -0,0 +1,58 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "explicit.h"
+
+#ifndef BITSTATE_H
+#define BITSTATE_H
+
+/**
+ * The outcome of a bitstate search.
+ */
+typedef struct {
+    // the markings visited, and the number of times a transition fired
+    uint64_t states;
+    uint64_t transitions;
+
+    // the size of the bit array, the bits that are set, and the number of hash functions
+    uint64_t num_bits;
+    uint64_t bits_set;
+    int num_hashes;
+
+    // the expected number of new markings that were taken for visited ones
+    double omitted;
+
+    size_t max_depth;
+
+    // the new markings that were not expanded because the stack reached the depth bound
+    uint64_t truncated;
+
+    double time;
+
+    // whether a marking satisfying the goal was found, and the transitions that lead to it from
+    // the initial marking
+    int found;
+    int *trace;
+    int trace_length;
+} bitstate_result_t;
+
+/**
+ * Searches the reachable markings of \p net depth-first, like supertrace: a marking is not stored,
+ * but sets \p num_hashes bits of a bit array of \p memory bytes, and a marking whose bits are all
+ * set is taken to be visited. Hash collisions can make the search miss markings, but every goal
+ * marking it finds is reachable. The search stops at the first marking that satisfies \p goal, a
+ * formula for which explicit_is_state_formula holds, or explores all markings it can reach if
+ * \p goal is NULL. With \p reduce only the enabled transitions of a stubborn set are fired.
+ * Like SPIN's -m, the stack holds at most \p depth_bound markings; new markings above it are
+ * checked against the goal but not expanded, so the search can miss markings this way too.
+ * The trace of the result must be freed.
+ */
+void bitstate_search(explicit_net_t *net, size_t memory, int num_hashes, size_t depth_bound, ctl_node_t *goal,
+        int reduce, bitstate_result_t *result);
+
+/**
+ * \return: the probability that a new marking is taken for a visited one, at the end of the search
+ * of \p result.
+ */
+double bitstate_collision_probability(bitstate_result_t *result);
+
+#endif
@@ -0,0 +1,104 @@
+#include "cone.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+typedef struct {
+    char *places;
+    int *queue;
+    int size;
+} cone_search_t;
+
+static void add_place(cone_search_t *search, place_t *place) {
+    if (!search->places[place->identifier]) {
+        search->places[place->identifier] = 1;
+        search->queue[search->size++] = place->identifier;
+    }
+}
+
+// add the input places of a transition, whose enabling depends on them
+static void add_inputs(cone_search_t *search, transition_t *transition) {
+    for (int i = 0; i < transition->num_arcs; i++) {
+        if (transition->arcs[i].dir == ARC_IN) add_place(search, transition->arcs[i].place);
+    }
+}
+
+static void add_atom(ctl_node_t *node, void *arg) {
+    if (node->type != CTL_ATOM) return;
+
+    for (int i = 0; i < node->atom.num_transitions; i++) {
+        add_inputs(arg, node->atom.fireable_transitions + i);
+    }
+}
+
+int cone_of_influence(andl_context_t *andl_context, ctl_node_t *formula, char *places, char *transitions) {
+    int num_places = andl_context->num_places;
+    int num_transitions = andl_context->num_transitions;
+
+    // the transitions with an arc to or from every place, every arc changes the marking of its place
+    int *start = calloc(num_places + 1, sizeof(int));
+
+    for (int t = 0; t < num_transitions; t++) {
+        transition_t *transition = andl_context->transitions + t;
+
+        for (int i = 0; i < transition->num_arcs; i++) {
+            start[transition->arcs[i].place->identifier + 1]++;
+        }
+    }
+
+    for (int p = 0; p < num_places; p++) start[p + 1] += start[p];
+
+    int *fill = mmalloc((num_places + 1) * sizeof(int));
+    memcpy(fill, start, num_places * sizeof(int));
+
+    int *trans_of = mmalloc((start[num_places] + 1) * sizeof(int));
+
+    for (int t = 0; t < num_transitions; t++) {
+        transition_t *transition = andl_context->transitions + t;
+
+        for (int i = 0; i < transition->num_arcs; i++) {
+            trans_of[fill[transition->arcs[i].place->identifier]++] = t;
+        }
+    }
+
+    memset(places, 0, num_places);
+    memset(transitions, 0, num_transitions);
+
+    cone_search_t search = { places, mmalloc((num_places + 1) * sizeof(int)), 0 };
+
+    ctl_visit(formula, add_atom, &search);
+
+    for (int head = 0; head < search.size; head++) {
+        int p = search.queue[head];
+
+        for (int i = start[p]; i < start[p + 1]; i++) {
+            int t = trans_of[i];
+
+            if (!transitions[t]) {
+                transitions[t] = 1;
+                add_inputs(&search, andl_context->transitions + t);
+            }
+        }
+    }
+
+    int size = search.size;
+
+    free(search.queue);
+    free(trans_of);
+    free(fill);
+    free(start);
+
+    return size;
+}
+
+static void find_next(ctl_node_t *node, void *arg) {
+    if (node->type == CTL_EX || node->type == CTL_EG) *(int *) arg = 0;
+}
+
+int cone_preserves(ctl_node_t *formula) {
+    int preserves = 1;
+    ctl_visit(formula, find_next, &preserves);
+    return preserves;
+}
@@ -0,0 +1,27 @@
+#include "andl.h"
+#include "ctl.h"
+
+#ifndef CONE_H
+#define CONE_H
+
+/**
+ * Computes the cone of influence of a normalized \p formula in the net of \p andl_context. The
+ * places of the cone are the input places of the transitions in the atoms of the formula, and the
+ * input places of every transition that changes a place of the cone. The transitions of the cone
+ * are those that change a place of the cone; the other transitions can neither enable nor disable
+ * them.
+ * \p places: set to 1 for every place in the cone, indexed by identifier.
+ * \p transitions: set to 1 for every transition in the cone, indexed by identifier.
+ * \return: the number of places in the cone.
+ */
+int cone_of_influence(andl_context_t *andl_context, ctl_node_t *formula, char *places, char *transitions);
+
+/**
+ * Whether checking \p formula on the cone of influence gives the same result as on the whole net.
+ * This holds when the formula has no EX and no EG: the transitions outside the cone only add
+ * steps that leave the places of the cone unchanged, which EU cannot observe, but which can make
+ * EX true or make a path infinite.
+ */
+int cone_preserves(ctl_node_t *formula);
+
+#endif
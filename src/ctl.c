@@ -1,6 +1,11 @@
+#include <stdint.h>
+#include <string.h>
+
 #include <sylvan.h>
 
 #include "ctl.h"
+#include "reorder.h"
+#include "util.h"
 
 ctl_node_t *normalize_EF(ctl_node_t *ast);
 ctl_node_t *normalize_AX(ctl_node_t *ast);
@@ -12,40 +17,65 @@ ctl_node_t *normalize_ER(ctl_node_t *ast);
 
 
 ctl_node_t *normalize(ctl_node_t *node) {
-    switch(node->type) {
+	if (node->normalized != NULL) {
+		return node->normalized;
+	}
+
+	ctl_node_t *result;
+
+	switch(node->type) {
 	    case CTL_ATOM:
-	    	return node;
+	    	result = node;
+	    	break;
 	    case CTL_NEGATION:
+	    	result = negate(normalize(node->unary.child));
+	    	break;
 	    case CTL_EX:
+	    	result = ctl_make_EX(normalize(node->unary.child));
+	    	break;
 	    case CTL_EG:
-	    	node->unary.child = normalize(node->unary.child);
-	    	return node;
+	    	result = ctl_make_EG(normalize(node->unary.child));
+	    	break;
 	    case CTL_CONJUNCTION:
+	    	result = conjunction(normalize(node->binary.left), normalize(node->binary.right));
+	    	break;
 	    case CTL_DISJUNCTION:
+	    	result = disjunction(normalize(node->binary.left), normalize(node->binary.right));
+	    	break;
 	    case CTL_EU:
-	    	node->binary.left = normalize(node->binary.left);
-	    	node->binary.right = normalize(node->binary.right);
-	    	return node;
+	    	result = ctl_make_EU(normalize(node->binary.left), normalize(node->binary.right));
+	    	break;
 	    case CTL_EF:
-	    	return normalize_EF(node);
+	    	result = normalize_EF(node);
+	    	break;
 	    case CTL_ER:
-	    	return normalize_ER(node);
+	    	result = normalize_ER(node);
+	    	break;
 	    case CTL_AX:
-	    	return normalize_AX(node);
+	    	result = normalize_AX(node);
+	    	break;
 	    case CTL_AF:
-	    	return normalize_AF(node);
+	    	result = normalize_AF(node);
+	    	break;
 	    case CTL_AG:
-	    	return normalize_AG(node);
+	    	result = normalize_AG(node);
+	    	break;
 	    case CTL_AU:
-	    	return normalize_AU(node);
+	    	result = normalize_AU(node);
+	    	break;
 	    case CTL_AR:
-	    	return normalize_AR(node);
+	    	result = normalize_AR(node);
+	    	break;
 	    default:
 	    	printf("Unhandled case in normalize\n");
 	    	return NULL;
     }
 
-    return NULL;
+	// a normal form is its own normal form
+	node->normalized = result;
+	result->normalized = result;
+
+	return result;
 }
 
 // print this CTL formula to stdout, useful for debugging
@@ -154,112 +184,281 @@ void print_ctl(ctl_node_t *node) {
 	printf("\n");
 }
 
+//hash-consing
+
+// nodes are allocated in blocks of this many nodes
+#define CTL_ARENA_BLOCK 1024
+
+typedef struct ctl_arena_block_t ctl_arena_block_t;
+
+struct ctl_arena_block_t {
+    ctl_arena_block_t *next;
+    int used;
+    ctl_node_t nodes[CTL_ARENA_BLOCK];
+};
+
+static ctl_arena_block_t *arena = NULL;
+
+static ctl_node_t **table = NULL;
+static size_t table_size = 0;
+static size_t num_unique = 0;
+static size_t num_constructed = 0;
+
+static ctl_node_t *arena_alloc() {
+    if (arena == NULL || arena->used == CTL_ARENA_BLOCK) {
+        ctl_arena_block_t *block = mmalloc(sizeof(ctl_arena_block_t));
+        block->next = arena;
+        block->used = 0;
+        arena = block;
+    }
+
+    return arena->nodes + arena->used++;
+}
+
+static size_t ctl_hash(ctl_node_t *node) {
+    uint64_t h = node->type;
+
+    switch(node->type) {
+        case CTL_ATOM:
+            h = h * 31 + (uint64_t) (node->atom.num_transitions + 1);
+            for (int i = 0; i < node->atom.num_transitions; i++) {
+                h = h * 31 + (uint64_t) node->atom.fireable_transitions[i].identifier;
+            }
+            break;
+        case CTL_NEGATION:
+        case CTL_EX:
+        case CTL_EF:
+        case CTL_EG:
+        case CTL_AX:
+        case CTL_AF:
+        case CTL_AG:
+            h = h * 31 + (uint64_t) (uintptr_t) node->unary.child;
+            break;
+        default:
+            h = h * 31 + (uint64_t) (uintptr_t) node->binary.left;
+            h = h * 31 + (uint64_t) (uintptr_t) node->binary.right;
+            break;
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+
+    return (size_t) h;
+}
+
+static int ctl_equal(ctl_node_t *a, ctl_node_t *b) {
+    if (a->type != b->type) return 0;
+
+    switch(a->type) {
+        case CTL_ATOM:
+            if (a->atom.num_transitions != b->atom.num_transitions) return 0;
+            for (int i = 0; i < a->atom.num_transitions; i++) {
+                if (a->atom.fireable_transitions[i].identifier != b->atom.fireable_transitions[i].identifier) return 0;
+            }
+            return 1;
+        case CTL_NEGATION:
+        case CTL_EX:
+        case CTL_EF:
+        case CTL_EG:
+        case CTL_AX:
+        case CTL_AF:
+        case CTL_AG:
+            return a->unary.child == b->unary.child;
+        default:
+            return a->binary.left == b->binary.left && a->binary.right == b->binary.right;
+    }
+}
+
+static void table_grow() {
+    size_t old_size = table_size;
+    ctl_node_t **old = table;
+
+    table_size = old_size == 0 ? 1024 : old_size * 2;
+    table = calloc(table_size, sizeof(ctl_node_t *));
+
+    for (size_t i = 0; i < old_size; i++) {
+        ctl_node_t *node = old[i];
+
+        while (node != NULL) {
+            ctl_node_t *next = node->hash_next;
+            size_t bucket = ctl_hash(node) & (table_size - 1);
+
+            node->hash_next = table[bucket];
+            table[bucket] = node;
+            node = next;
+        }
+    }
+
+    free(old);
+}
+
+/*
+ * Returns the unique node that is structurally equal to \p proto, creating it if it does not exist.
+ * For atoms, the unique node takes ownership of the transitions of \p proto when it is created,
+ * and they are freed otherwise.
+ */
+static ctl_node_t *ctl_intern(ctl_node_t *proto) {
+    num_constructed++;
+
+    if (2 * (num_unique + 1) > table_size) table_grow();
+
+    size_t bucket = ctl_hash(proto) & (table_size - 1);
+
+    for (ctl_node_t *node = table[bucket]; node != NULL; node = node->hash_next) {
+        if (ctl_equal(node, proto)) {
+            if (proto->type == CTL_ATOM) free(proto->atom.fireable_transitions);
+            return node;
+        }
+    }
+
+    ctl_node_t *node = arena_alloc();
+    *node = *proto;
+    node->result = sylvan_invalid;
+    node->ldd_result = sylvan_invalid;
+    node->zdd_result = zdd_invalid;
+    node->normalized = NULL;
+    node->simplified = NULL;
+    node->visited = 0;
+    node->hash_next = table[bucket];
+    table[bucket] = node;
+    num_unique++;
+
+    return node;
+}
+
+static ctl_node_t *make_unary(ctl_type_t type, ctl_node_t *child) {
+    ctl_node_t proto;
+    proto.type = type;
+    proto.unary.child = child;
+    return ctl_intern(&proto);
+}
+
+static ctl_node_t *make_binary(ctl_type_t type, ctl_node_t *left, ctl_node_t *right) {
+    ctl_node_t proto;
+    proto.type = type;
+    proto.binary.left = left;
+    proto.binary.right = right;
+    return ctl_intern(&proto);
+}
+
+void ctl_report() {
+    warn("CTL formulas: %zu nodes constructed, %zu unique", num_constructed, num_unique);
+}
+
+void ctl_free_all() {
+    for (ctl_arena_block_t *block = arena; block != NULL; ) {
+        for (int i = 0; i < block->used; i++) {
+            ctl_node_t *node = block->nodes + i;
+
+            if (node->result != sylvan_invalid) reorder_unprotect(&node->result);
+            if (node->ldd_result != sylvan_invalid) lddmc_unprotect(&node->ldd_result);
+            if (node->zdd_result != zdd_invalid) zdd_unprotect(&node->zdd_result);
+            if (node->type == CTL_ATOM) free(node->atom.fireable_transitions);
+        }
+
+        ctl_arena_block_t *next = block->next;
+        free(block);
+        block = next;
+    }
+
+    free(table);
+
+    arena = NULL;
+    table = NULL;
+    table_size = 0;
+    num_unique = 0;
+    num_constructed = 0;
+}
+
 //basic building blocks
 ctl_node_t *makeTrue() {
-    ctl_node_t *trueStateProperty = malloc(sizeof(ctl_node_t));
-    trueStateProperty->type = CTL_ATOM;
-    trueStateProperty->atom.num_transitions = -1;
-    return trueStateProperty;
+    ctl_node_t proto;
+    proto.type = CTL_ATOM;
+    proto.atom.num_transitions = -1;
+    proto.atom.fireable_transitions = NULL;
+    return ctl_intern(&proto);
+}
+
+static int compare_transitions(const void *a, const void *b) {
+    return ((const transition_t *) a)->identifier - ((const transition_t *) b)->identifier;
+}
+
+ctl_node_t *ctl_make_atom(transition_t *transitions, int num_transitions) {
+    ctl_node_t proto;
+    proto.type = CTL_ATOM;
+    proto.atom.fireable_transitions = mmalloc((num_transitions + 1) * sizeof(transition_t));
+    proto.atom.num_transitions = 0;
+
+    memcpy(proto.atom.fireable_transitions, transitions, num_transitions * sizeof(transition_t));
+    qsort(proto.atom.fireable_transitions, num_transitions, sizeof(transition_t), compare_transitions);
+
+    // is-fireable(t, t) is is-fireable(t)
+    for (int i = 0; i < num_transitions; i++) {
+        transition_t *transition = proto.atom.fireable_transitions + i;
+        int n = proto.atom.num_transitions;
+
+        if (n == 0 || proto.atom.fireable_transitions[n - 1].identifier != transition->identifier) {
+            proto.atom.fireable_transitions[proto.atom.num_transitions++] = *transition;
+        }
+    }
+
+    return ctl_intern(&proto);
 }
 
 ctl_node_t *negate(ctl_node_t *node) {
-	ctl_node_t *negation = malloc(sizeof(ctl_node_t));
-	negation->type = CTL_NEGATION;
-	negation->unary.child = node;
-	return negation;
+	return make_unary(CTL_NEGATION, node);
 }
 
 ctl_node_t *conjunction(ctl_node_t *formula1, ctl_node_t *formula2) {
-    ctl_node_t *conj  = malloc(sizeof(ctl_node_t));
-    conj->type = CTL_CONJUNCTION;
-    conj->binary.left = formula1;
-    conj->binary.right = formula2;
-    return conj;
+    return make_binary(CTL_CONJUNCTION, formula1, formula2);
 }
 
 ctl_node_t *disjunction(ctl_node_t *formula1, ctl_node_t *formula2) {
-    ctl_node_t *disj  = malloc(sizeof(ctl_node_t));
-    disj->type = CTL_DISJUNCTION;
-    disj->binary.left = formula1;
-    disj->binary.right = formula2;
-    return disj;
+    return make_binary(CTL_DISJUNCTION, formula1, formula2);
 }
 
 
 //TL constructors
 //Exists
 ctl_node_t *ctl_make_EX(ctl_node_t *inner) {
-    ctl_node_t *ex  = malloc(sizeof(ctl_node_t));
-    ex->type = CTL_EX;
-    ex->unary.child = inner;
-    return ex;
+    return make_unary(CTL_EX, inner);
 }
 
 ctl_node_t *ctl_make_EG(ctl_node_t *inner) {
-    ctl_node_t *eg = malloc(sizeof(ctl_node_t));
-    eg->type = CTL_EG;
-    eg->unary.child = inner;
-    return eg;
+    return make_unary(CTL_EG, inner);
 }
 
 ctl_node_t *ctl_make_EF(ctl_node_t *inner) {
-    ctl_node_t *ef = malloc(sizeof(ctl_node_t));
-    ef->type = CTL_EF;
-    ef->unary.child = inner;
-    return ef;
+    return make_unary(CTL_EF, inner);
 }
 
 ctl_node_t *ctl_make_EU(ctl_node_t *innerOne, ctl_node_t *innerTwo) {
-    ctl_node_t *eu  = malloc(sizeof(ctl_node_t));
-    eu->type = CTL_EU;
-    eu->binary.left = innerOne;
-    eu->binary.right = innerTwo;
-    return eu;
+    return make_binary(CTL_EU, innerOne, innerTwo);
 }
 
 ctl_node_t *ctl_make_ER(ctl_node_t *innerOne, ctl_node_t *innerTwo) {
-    ctl_node_t *er  = malloc(sizeof(ctl_node_t));
-    er->type = CTL_ER;
-    er->binary.left = innerOne;
-    er->binary.right = innerTwo;
-    return er;
+    return make_binary(CTL_ER, innerOne, innerTwo);
 }
 //ForAll
 ctl_node_t *ctl_make_AX(ctl_node_t *inner) {
-    ctl_node_t *ax  = malloc(sizeof(ctl_node_t));
-    ax->type = CTL_AX;
-    ax->unary.child = inner;
-    return ax;
+    return make_unary(CTL_AX, inner);
 }
 
 ctl_node_t *ctl_make_AG(ctl_node_t *inner) {
-    ctl_node_t *ag = malloc(sizeof(ctl_node_t));
-    ag->type = CTL_AG;
-    ag->unary.child = inner;
-    return ag;
+    return make_unary(CTL_AG, inner);
 }
 
 ctl_node_t *ctl_make_AF(ctl_node_t *inner) {
-    ctl_node_t *af = malloc(sizeof(ctl_node_t));
-    af->type = CTL_AF;
-    af->unary.child = inner;
-    return af;
+    return make_unary(CTL_AF, inner);
 }
 
 ctl_node_t *ctl_make_AU(ctl_node_t *innerOne, ctl_node_t *innerTwo) {
-    ctl_node_t *au  = malloc(sizeof(ctl_node_t));
-    au->type = CTL_AU;
-    au->binary.left = innerOne;
-    au->binary.right = innerTwo;
-    return au;
+    return make_binary(CTL_AU, innerOne, innerTwo);
 }
 
 ctl_node_t *ctl_make_AR(ctl_node_t *innerOne, ctl_node_t *innerTwo) {
-    ctl_node_t *ar  = malloc(sizeof(ctl_node_t));
-    ar->type = CTL_AR;
-    ar->binary.left = innerOne;
-    ar->binary.right = innerTwo;
-    return ar;
+    return make_binary(CTL_AR, innerOne, innerTwo);
 }
 
 
@@ -268,91 +467,278 @@ ctl_node_t *ctl_make_AR(ctl_node_t *innerOne, ctl_node_t *innerTwo) {
 //normalization cases
 
 ctl_node_t *normalize_EF(ctl_node_t *node) {
-	ctl_node_t *result = malloc(sizeof(ctl_node_t));
+	// EF p = E[true U p]
+	return ctl_make_EU(makeTrue(), normalize(node->unary.child));
+}
 
-	result->type = CTL_EU;
-	result->binary.left = makeTrue();
-	result->binary.right = normalize(node->unary.child);
+ctl_node_t *normalize_AX(ctl_node_t *node) {
+	// AX p = !EX !p
+	return negate(ctl_make_EX(negate(normalize(node->unary.child))));
+}
 
-	free(node);
+ctl_node_t *normalize_AG(ctl_node_t *node) {
+	// AG p = !EF !p
+	return negate(normalize(ctl_make_EF(negate(normalize(node->unary.child)))));
+}
 
-    return result;
+ctl_node_t *normalize_AF(ctl_node_t *node) {
+	// AF p = !EG !p
+	return negate(ctl_make_EG(negate(normalize(node->unary.child))));
 }
 
-ctl_node_t *normalize_AX(ctl_node_t *node) {
-	ctl_node_t *result = malloc(sizeof(ctl_node_t));
+ctl_node_t *normalize_AR(ctl_node_t *node) {
+	// A[p R q] = !E[!p U !q]
+	return negate(ctl_make_EU(negate(normalize(node->binary.left)), negate(normalize(node->binary.right))));
+}
 
-	result->type = CTL_EX;
-	result->unary.child = negate(normalize(node->unary.child));
+ctl_node_t *normalize_AU(ctl_node_t *node) {
+	// A[p U q] = !E[!p R !q]
+	return negate(normalize(ctl_make_ER(negate(normalize(node->binary.left)), negate(normalize(node->binary.right)))));
+}
 
-	free(node);
+ctl_node_t *normalize_ER(ctl_node_t *node) {
+	// E[p R q] = E[q U (p && q)] || EG q
+	ctl_node_t *child_right = normalize(node->binary.right);
+	ctl_node_t *child_left = normalize(node->binary.left);
 
-    return negate(result);
+	ctl_node_t *left = ctl_make_EU(child_right, conjunction(child_left, child_right));
+	ctl_node_t *right = ctl_make_EG(child_right);
+
+	return disjunction(left, right);
 }
 
-ctl_node_t *normalize_AG(ctl_node_t *node) {
-	ctl_node_t *result = malloc(sizeof(ctl_node_t));
 
-	result->type = CTL_EF;
-	result->unary.child = negate(normalize(node->unary.child));
+//simplification
 
-	free(node);
+static int is_true(ctl_node_t *node) {
+	return node->type == CTL_ATOM && node->atom.num_transitions == -1;
+}
 
-    return negate(normalize(result));
+static int is_false(ctl_node_t *node) {
+	return node->type == CTL_NEGATION && is_true(node->unary.child);
 }
 
-ctl_node_t *normalize_AF(ctl_node_t *node) {
-	ctl_node_t *result = malloc(sizeof(ctl_node_t));
+static int is_fireability(ctl_node_t *node) {
+	return node->type == CTL_ATOM && node->atom.num_transitions >= 0;
+}
+
+// whether one formula is the negation of the other
+static int is_complement(ctl_node_t *a, ctl_node_t *b) {
+	return (a->type == CTL_NEGATION && a->unary.child == b) || (b->type == CTL_NEGATION && b->unary.child == a);
+}
 
-	result->type = CTL_EG;
-	result->unary.child = negate(normalize(node->unary.child));
+typedef struct {
+	ctl_node_t **nodes;
+	int size;
+	int capacity;
+} operands_t;
+
+// collect the operands of a tree of disjunctions
+static void collect_disjuncts(ctl_node_t *node, operands_t *operands) {
+	if (node->type == CTL_DISJUNCTION) {
+		collect_disjuncts(node->binary.left, operands);
+		collect_disjuncts(node->binary.right, operands);
+		return;
+	}
 
-	free(node);
+	if (operands->size == operands->capacity) {
+		operands->capacity *= 2;
+		operands->nodes = rrealloc(operands->nodes, operands->capacity * sizeof(ctl_node_t *));
+	}
 
-    return negate(result);
+	operands->nodes[operands->size++] = node;
 }
 
-ctl_node_t *normalize_AR(ctl_node_t *node) {
-	ctl_node_t *result = malloc(sizeof(ctl_node_t));
+/*
+ * Simplify a disjunction of simplified formulas. The disjunction is flattened, and
+ * is-fireable(T1) || is-fireable(T2) becomes is-fireable(T1 + T2), at the place of the first atom.
+ * FALSE operands and duplicates are dropped, and a TRUE operand or an operand together with its
+ * negation makes the whole disjunction TRUE.
+ */
+static ctl_node_t *simplify_disjunction(ctl_node_t *left, ctl_node_t *right) {
+	operands_t operands = { mmalloc(8 * sizeof(ctl_node_t *)), 0, 8 };
+	collect_disjuncts(left, &operands);
+	collect_disjuncts(right, &operands);
+
+	int num_transitions = 0;
+	for (int i = 0; i < operands.size; i++) {
+		if (is_fireability(operands.nodes[i])) num_transitions += operands.nodes[i]->atom.num_transitions;
+	}
 
-	result->type = CTL_EU;
-	result->binary.left = negate(normalize(node->binary.left));
-	result->binary.right = negate(normalize(node->binary.right));
+	transition_t *transitions = mmalloc((num_transitions + 1) * sizeof(transition_t));
+	num_transitions = 0;
+
+	int first_atom = -1;
+	int num_kept = 0;
+	int tautology = 0;
+
+	for (int i = 0; i < operands.size; i++) {
+		ctl_node_t *operand = operands.nodes[i];
+
+		if (is_true(operand)) {
+			tautology = 1;
+		} else if (is_fireability(operand)) {
+			memcpy(transitions + num_transitions, operand->atom.fireable_transitions,
+					operand->atom.num_transitions * sizeof(transition_t));
+			num_transitions += operand->atom.num_transitions;
+
+			if (first_atom == -1) {
+				first_atom = num_kept;
+				operands.nodes[num_kept++] = operand;
+			}
+		} else if (!is_false(operand)) {
+			int duplicate = 0;
+
+			for (int j = 0; j < num_kept; j++) {
+				if (operands.nodes[j] == operand) duplicate = 1;
+				if (is_complement(operands.nodes[j], operand)) tautology = 1;
+			}
+
+			if (!duplicate) operands.nodes[num_kept++] = operand;
+		}
+	}
+
+	if (first_atom != -1) operands.nodes[first_atom] = ctl_make_atom(transitions, num_transitions);
+	free(transitions);
+
+	ctl_node_t *result;
+
+	if (tautology) {
+		result = makeTrue();
+	} else if (num_kept == 0) {
+		result = negate(makeTrue());
+	} else {
+		result = operands.nodes[0];
+
+		for (int i = 1; i < num_kept; i++) {
+			result = disjunction(result, operands.nodes[i]);
+		}
+	}
 
-	free(node);
+	free(operands.nodes);
 
-    return negate(result);
+	return result;
 }
 
-ctl_node_t *normalize_AU(ctl_node_t *node) {
-	ctl_node_t *result = malloc(sizeof(ctl_node_t));
+static ctl_node_t *simplify_conjunction(ctl_node_t *left, ctl_node_t *right) {
+	if (is_false(left) || is_true(right)) return left;
+	if (is_false(right) || is_true(left)) return right;
+	if (left == right) return left;
+	if (is_complement(left, right)) return negate(makeTrue());
 
-	result->type = CTL_ER;
-	result->binary.left = negate(normalize(node->binary.left));
-	result->binary.right = negate(normalize(node->binary.right));
+	return conjunction(left, right);
+}
 
-	free(node);
+static ctl_node_t *simplify_EU(ctl_node_t *left, ctl_node_t *right) {
+	// E[p U TRUE] = TRUE, E[p U FALSE] = FALSE, E[FALSE U q] = q, E[p U p] = p
+	if (is_true(right) || is_false(right) || is_false(left) || left == right) return right;
 
-    return negate(normalize(result));
+	// EF EF p = EF p
+	if (is_true(left) && right->type == CTL_EU && is_true(right->binary.left)) return right;
+
+	return ctl_make_EU(left, right);
 }
 
-ctl_node_t *normalize_ER(ctl_node_t *node) {
-	ctl_node_t *left = malloc(sizeof(ctl_node_t));
+ctl_node_t *simplify(ctl_node_t *node) {
+	if (node->simplified != NULL) {
+		return node->simplified;
+	}
 
-	left->type = CTL_EU;
+	ctl_node_t *result;
+	ctl_node_t *child;
 
-	ctl_node_t *child_right = normalize(node->binary.right);
-	ctl_node_t *child_left = normalize(node->binary.left);
+	switch(node->type) {
+	    case CTL_ATOM:
+	    	result = node;
+	    	break;
+	    case CTL_NEGATION:
+	    	// !!p = p
+	    	child = simplify(node->unary.child);
+	    	result = child->type == CTL_NEGATION ? child->unary.child : negate(child);
+	    	break;
+	    case CTL_EX:
+	    	// EX FALSE = FALSE
+	    	child = simplify(node->unary.child);
+	    	result = is_false(child) ? child : ctl_make_EX(child);
+	    	break;
+	    case CTL_EG:
+	    	// EG FALSE = FALSE, EG EG p = EG p
+	    	child = simplify(node->unary.child);
+	    	result = is_false(child) || child->type == CTL_EG ? child : ctl_make_EG(child);
+	    	break;
+	    case CTL_CONJUNCTION:
+	    	result = simplify_conjunction(simplify(node->binary.left), simplify(node->binary.right));
+	    	break;
+	    case CTL_DISJUNCTION:
+	    	result = simplify_disjunction(simplify(node->binary.left), simplify(node->binary.right));
+	    	break;
+	    case CTL_EU:
+	    	result = simplify_EU(simplify(node->binary.left), simplify(node->binary.right));
+	    	break;
+	    default:
+	    	printf("Unhandled case in simplify, the formula is not normalized\n");
+	    	return NULL;
+	}
+
+	// a simplified formula is its own simplified form
+	node->simplified = result;
+	result->simplified = result;
+
+	return result;
+}
+
+static unsigned traversal = 0;
+
+static int count_fixpoints(ctl_node_t *node) {
+	if (node->visited == traversal) return 0;
+	node->visited = traversal;
+
+	switch(node->type) {
+	    case CTL_ATOM:
+	    	return 0;
+	    case CTL_NEGATION:
+	    case CTL_EX:
+	    	return count_fixpoints(node->unary.child);
+	    case CTL_EG:
+	    	return 1 + count_fixpoints(node->unary.child);
+	    case CTL_EU:
+	    	return 1 + count_fixpoints(node->binary.left) + count_fixpoints(node->binary.right);
+	    default:
+	    	return count_fixpoints(node->binary.left) + count_fixpoints(node->binary.right);
+	}
+}
 
-	left->binary.left = child_right;
-	left->binary.right = conjunction(child_left, child_right);
+int ctl_count_fixpoints(ctl_node_t *node) {
+	traversal++;
+	return count_fixpoints(node);
+}
 
-	ctl_node_t *right = malloc(sizeof(ctl_node_t));
+static void visit_rec(ctl_node_t *node, void (*visit)(ctl_node_t *node, void *arg), void *arg) {
+	if (node->visited == traversal) return;
+	node->visited = traversal;
 
-	right->type = CTL_EG;
-	right->unary.child = child_right;
+	switch(node->type) {
+	    case CTL_ATOM:
+	    	break;
+	    case CTL_NEGATION:
+	    case CTL_EX:
+	    case CTL_EF:
+	    case CTL_EG:
+	    case CTL_AX:
+	    case CTL_AF:
+	    case CTL_AG:
+	    	visit_rec(node->unary.child, visit, arg);
+	    	break;
+	    default:
+	    	visit_rec(node->binary.left, visit, arg);
+	    	visit_rec(node->binary.right, visit, arg);
+	    	break;
+	}
 
-	free(node);
+	visit(node, arg);
+}
 
-    return disjunction(left, right);
-}
\ No newline at end of file
+void ctl_visit(ctl_node_t *node, void (*visit)(ctl_node_t *node, void *arg), void *arg) {
+	traversal++;
+	visit_rec(node, visit, arg);
+}
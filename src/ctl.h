@@ -1,5 +1,6 @@
 #include <sylvan.h>
 #include "andl.h"
+#include "zdd.h"
 
 #ifndef CTL_H
 #define CTL_H
@@ -23,9 +24,38 @@ typedef enum {
 
 typedef struct ctl_node_t ctl_node_t;
 
+/**
+ * A node of a CTL formula. Nodes are hash-consed: structurally equal formulas are the same node,
+ * so the formulas of a property set form a single DAG. Nodes must not be modified after they have
+ * been constructed, and are only freed all at once by ctl_free_all.
+ */
 typedef struct ctl_node_t
 {
     ctl_type_t type;
+
+    // the BDD of the states satisfying this formula, sylvan_invalid until check_BDD computed it
+    BDD result;
+
+    // the LDD of the reachable states satisfying this formula, sylvan_invalid until check_LDD
+    // computed it
+    MDD ldd_result;
+
+    // the ZDD of the reachable states satisfying this formula, zdd_invalid until check_ZDD computed
+    // it
+    ZDD zdd_result;
+
+    // the normal form of this formula, NULL until normalize computed it
+    ctl_node_t *normalized;
+
+    // the simplified form of this formula, NULL until simplify computed it
+    ctl_node_t *simplified;
+
+    // the next node in the same bucket of the hash-consing table
+    ctl_node_t *hash_next;
+
+    // the last traversal of the DAG that visited this node
+    unsigned visited;
+
     union {
         struct
         {
@@ -40,6 +70,7 @@ typedef struct ctl_node_t
 
         struct
         {
+            // sorted by identifier, without duplicates
             transition_t *fireable_transitions;
 
             //value of -1 represents true value
@@ -53,6 +84,11 @@ typedef struct ctl_node_t
 //basic building blocks
 ctl_node_t *makeTrue();
 
+/**
+ * Makes the atom is-fireable(t1, ..., tn). The transitions are copied.
+ */
+ctl_node_t *ctl_make_atom(transition_t *transitions, int num_transitions);
+
 //state properties
 ctl_node_t *negate(ctl_node_t *formula);
 ctl_node_t *conjunction(ctl_node_t *formula1, ctl_node_t *formula2);
@@ -74,13 +110,45 @@ ctl_node_t *ctl_make_AR(ctl_node_t *innerOne, ctl_node_t *innerTwo);
 /**
  * Normalizes a CTL formula to only contain temporal logic clauses EU, EG and EX.
  * Naturally, regular negations, conjunctions and disjunctions can be part of the resulting formula.
- * This function will free any pointers to subformulas that are rewritten.
+ * The old formula is left intact, and the normal form is remembered in every node, so shared
+ * subformulas are only normalized once.
  *
  * @param ast a pointer to the old CTL formula
  * @return a pointer to the new CTL formula
  */
 ctl_node_t *normalize(ctl_node_t *ast);
 
+/**
+ * Simplifies a normalized CTL formula: double negations are removed, EF EF p and EG EG p are
+ * collapsed, TRUE and FALSE (the negation of TRUE) are folded away, and the fireability atoms of a
+ * disjunction are merged into one atom. Like the normal form, the simplified form is remembered in
+ * every node.
+ *
+ * @param ast a pointer to a normalized CTL formula
+ * @return a pointer to the simplified CTL formula
+ */
+ctl_node_t *simplify(ctl_node_t *ast);
+
+/**
+ * Counts the distinct EU and EG nodes of a normalized formula, the fixpoints check_BDD has to compute.
+ */
+int ctl_count_fixpoints(ctl_node_t *ast);
+
+/**
+ * Calls \p visit once for every distinct node of a formula, children before their parents.
+ */
+void ctl_visit(ctl_node_t *ast, void (*visit)(ctl_node_t *node, void *arg), void *arg);
+
 void print_ctl(ctl_node_t *ast);
 
+/**
+ * Prints how many nodes were constructed, and how many of those were unique.
+ */
+void ctl_report();
+
+/**
+ * Frees all CTL nodes, and unprotects the BDDs cached in them.
+ */
+void ctl_free_all();
+
 #endif
\ No newline at end of file
@@ -0,0 +1,421 @@
+#include "explicit.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sylvan.h>
+
+#include "stubborn.h"
+#include "util.h"
+
+/*
+ * Index the transitions by the places in their masks: the transitions of place p are
+ * transitions[start[p]] up to transitions[start[p + 1]].
+ */
+static void index_places(explicit_net_t *net, uint64_t *masks, int **start, int **transitions) {
+    size_t words = (size_t) net->num_words;
+    int *fill = calloc(net->num_places + 1, sizeof(int));
+    int count = 0;
+
+    *start = calloc(net->num_places + 1, sizeof(int));
+
+    for (size_t i = 0; i < net->num_transitions * words; i++) {
+        for (uint64_t bits = masks[i]; bits != 0; bits &= bits - 1) {
+            (*start)[(i % words) * 64 + __builtin_ctzll(bits) + 1]++;
+            count++;
+        }
+    }
+
+    for (int p = 0; p < net->num_places; p++) (*start)[p + 1] += (*start)[p];
+    memcpy(fill, *start, net->num_places * sizeof(int));
+
+    *transitions = mmalloc((count + 1) * sizeof(int));
+
+    for (size_t i = 0; i < net->num_transitions * words; i++) {
+        for (uint64_t bits = masks[i]; bits != 0; bits &= bits - 1) {
+            (*transitions)[fill[(i % words) * 64 + __builtin_ctzll(bits)]++] = i / words;
+        }
+    }
+
+    free(fill);
+}
+
+explicit_net_t *explicit_build_net(andl_context_t *andl_context) {
+    explicit_net_t *net = mmalloc(sizeof(explicit_net_t));
+
+    net->num_places = andl_context->num_places;
+    net->num_words = (net->num_places + 63) / 64;
+    if (net->num_words == 0) net->num_words = 1;
+
+    net->num_transitions = andl_context->num_transitions;
+
+    size_t words = (size_t) net->num_words;
+    net->initial = calloc(words, sizeof(uint64_t));
+    net->pre = calloc((net->num_transitions + 1) * words, sizeof(uint64_t));
+    net->post = calloc((net->num_transitions + 1) * words, sizeof(uint64_t));
+    net->fires = mmalloc(net->num_transitions + 1);
+
+    for (int i = 0; i < net->num_places; i++) {
+        if (andl_context->places[i].initial_marking != 0) net->initial[i / 64] |= 1ull << (i % 64);
+    }
+
+    for (int t = 0; t < net->num_transitions; t++) {
+        transition_t *transition = andl_context->transitions + t;
+
+        for (int i = 0; i < transition->num_arcs; i++) {
+            arc_t *arc = transition->arcs + i;
+            int p = arc->place - andl_context->places;
+            uint64_t *mask = (arc->dir == ARC_IN ? net->pre : net->post) + t * words;
+
+            mask[p / 64] |= 1ull << (p % 64);
+        }
+
+        net->fires[t] = 1;
+        for (size_t w = 0; w < words; w++) {
+            if (net->pre[t * words + w] & net->post[t * words + w]) net->fires[t] = 0;
+        }
+    }
+
+    index_places(net, net->post, &net->producer_start, &net->producers);
+    index_places(net, net->pre, &net->consumer_start, &net->consumers);
+
+    return net;
+}
+
+void explicit_free_net(explicit_net_t *net) {
+    free(net->initial);
+    free(net->pre);
+    free(net->post);
+    free(net->fires);
+    free(net->producer_start);
+    free(net->producers);
+    free(net->consumer_start);
+    free(net->consumers);
+    free(net);
+}
+
+int explicit_enabled(explicit_net_t *net, const uint64_t *marking, int t) {
+    const uint64_t *pre = net->pre + (size_t) t * net->num_words;
+
+    for (int w = 0; w < net->num_words; w++) {
+        if ((marking[w] & pre[w]) != pre[w]) return 0;
+    }
+
+    return 1;
+}
+
+void explicit_fire(explicit_net_t *net, const uint64_t *marking, int t, uint64_t *result) {
+    const uint64_t *pre = net->pre + (size_t) t * net->num_words;
+    const uint64_t *post = net->post + (size_t) t * net->num_words;
+
+    for (int w = 0; w < net->num_words; w++) {
+        result[w] = (marking[w] & ~pre[w]) | post[w];
+    }
+}
+
+int explicit_eval(explicit_net_t *net, ctl_node_t *formula, const uint64_t *marking) {
+    switch (formula->type) {
+        case CTL_ATOM:
+            // -1 marks true value
+            if (formula->atom.num_transitions == -1) return 1;
+
+            for (int i = 0; i < formula->atom.num_transitions; i++) {
+                if (explicit_enabled(net, marking, formula->atom.fireable_transitions[i].identifier)) return 1;
+            }
+            return 0;
+        case CTL_NEGATION:
+            return !explicit_eval(net, formula->unary.child, marking);
+        case CTL_CONJUNCTION:
+            return explicit_eval(net, formula->binary.left, marking) && explicit_eval(net, formula->binary.right, marking);
+        case CTL_DISJUNCTION:
+            return explicit_eval(net, formula->binary.left, marking) || explicit_eval(net, formula->binary.right, marking);
+        default:
+            warn("Unknown case in explicit_eval");
+            return 0;
+    }
+}
+
+int explicit_is_state_formula(ctl_node_t *formula) {
+    switch (formula->type) {
+        case CTL_ATOM:
+            return 1;
+        case CTL_NEGATION:
+            return explicit_is_state_formula(formula->unary.child);
+        case CTL_CONJUNCTION:
+        case CTL_DISJUNCTION:
+            return explicit_is_state_formula(formula->binary.left) && explicit_is_state_formula(formula->binary.right);
+        default:
+            return 0;
+    }
+}
+
+/*
+ * The finalizer of MurmurHash3, which spreads every input bit over all output bits.
+ */
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t explicit_hash(const uint64_t *marking, int num_words, uint64_t seed) {
+    uint64_t h = mix(seed + 0x9e3779b97f4a7c15ull);
+
+    for (int w = 0; w < num_words; w++) {
+        h = mix(h ^ marking[w]) + 0x9e3779b97f4a7c15ull;
+    }
+
+    return mix(h);
+}
+
+/*
+ * The hash table of the markings, with open addressing and linear probing. A bucket is 0 while it
+ * is free; a worker claims it by swapping in the hash of its marking with BUCKET_BUSY, copies the
+ * marking into the slot and then sets BUCKET_DONE. Workers looking for an equal marking wait for
+ * the copy to finish. Markings are never removed, so no locks are needed. The table counts as full
+ * at MAX_LOAD percent of its buckets, since linear probing gets slow long before the last one.
+ */
+#define BUCKET_BUSY 1ull
+#define BUCKET_DONE 2ull
+#define BUCKET_FLAGS 3ull
+
+#define MAX_LOAD 90
+
+typedef struct {
+    uint64_t *buckets;
+    uint64_t *data;
+    size_t capacity;
+    int num_words;
+
+    // the number of buckets claimed, and the most that may be
+    size_t count;
+    size_t limit;
+} table_t;
+
+/*
+ * Finds \p marking in the table, or adds it.
+ * \return: the slot of the marking, or -1 if the table is full.
+ */
+static int64_t table_find_or_put(table_t *table, const uint64_t *marking, int *added) {
+    size_t words = (size_t) table->num_words;
+    uint64_t hash = explicit_hash(marking, table->num_words, 0);
+    uint64_t memo = hash & ~BUCKET_FLAGS;
+    size_t mask = table->capacity - 1;
+    size_t i = hash & mask;
+
+    for (size_t probes = 0; probes < table->capacity; probes++, i = (i + 1) & mask) {
+        uint64_t *bucket = table->buckets + i;
+        uint64_t value = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+
+        if (value == 0) {
+            // the marking is not in the table, so it takes a bucket if the load allows it
+            if (__atomic_fetch_add(&table->count, 1, __ATOMIC_RELAXED) >= table->limit) {
+                __atomic_fetch_sub(&table->count, 1, __ATOMIC_RELAXED);
+                return -1;
+            }
+
+            if (__sync_bool_compare_and_swap(bucket, 0, memo | BUCKET_BUSY)) {
+                memcpy(table->data + i * words, marking, words * sizeof(uint64_t));
+                __atomic_store_n(bucket, memo | BUCKET_DONE, __ATOMIC_RELEASE);
+
+                *added = 1;
+                return i;
+            }
+
+            // another worker claimed the bucket first, maybe for the same marking
+            __atomic_fetch_sub(&table->count, 1, __ATOMIC_RELAXED);
+            value = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+        }
+
+        if ((value & ~BUCKET_FLAGS) != memo) continue;
+
+        while ((value & BUCKET_FLAGS) == BUCKET_BUSY) value = __atomic_load_n(bucket, __ATOMIC_ACQUIRE);
+
+        if (memcmp(table->data + i * words, marking, words * sizeof(uint64_t)) == 0) {
+            *added = 0;
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * The state of a breadth-first search: the markings of the current level are the slots in
+ * frontier, the new markings of the next level are appended to next.
+ */
+typedef struct {
+    explicit_net_t *net;
+    table_t table;
+
+    size_t *frontier;
+    size_t *next;
+    size_t next_count;
+
+    uint64_t transitions;
+
+    // the markings to look for, or NULL to explore all reachable markings
+    ctl_node_t *goal;
+    int reduce;
+
+    // whether the table is full, and whether a goal marking was found; any worker may set them
+    int full;
+    int found;
+} search_t;
+
+// the number of markings a task expands before it stops splitting its range
+#define GRAIN 64
+
+/*
+ * Expand the markings of the frontier from up to (but excluding) to. The range is split in halves
+ * that are expanded as parallel tasks, so idle workers steal the halves of busy ones.
+ */
+VOID_TASK_3(explore_range, search_t *, search, size_t, from, size_t, to)
+{
+    if (to - from > GRAIN) {
+        size_t mid = from + (to - from) / 2;
+
+        SPAWN(explore_range, search, from, mid);
+        CALL(explore_range, search, mid, to);
+        SYNC(explore_range);
+        return;
+    }
+
+    explicit_net_t *net = search->net;
+    size_t words = (size_t) net->num_words;
+    uint64_t successor[words];
+    uint64_t fired = 0;
+
+    // the transitions to fire in a marking, all enabled ones without reduction
+    int *enabled = mmalloc((net->num_transitions + 1) * sizeof(int));
+    int *stack = mmalloc((net->num_transitions + 1) * sizeof(int));
+    char *in_set = mmalloc(net->num_transitions + 1);
+
+    for (size_t i = from; i < to; i++) {
+        if (__atomic_load_n(&search->full, __ATOMIC_RELAXED) || __atomic_load_n(&search->found, __ATOMIC_RELAXED)) break;
+
+        const uint64_t *marking = search->table.data + search->frontier[i] * words;
+
+        if (search->goal != NULL && explicit_eval(net, search->goal, marking)) {
+            __atomic_store_n(&search->found, 1, __ATOMIC_RELAXED);
+            break;
+        }
+
+        int num_enabled = 0;
+
+        if (search->reduce) {
+            num_enabled = stubborn_set(net, search->goal, marking, in_set, stack, enabled);
+        } else {
+            for (int t = 0; t < net->num_transitions; t++) {
+                if (net->fires[t] && explicit_enabled(net, marking, t)) enabled[num_enabled++] = t;
+            }
+        }
+
+        for (int j = 0; j < num_enabled; j++) {
+            int t = enabled[j];
+
+            explicit_fire(net, marking, t, successor);
+            fired++;
+
+            int added;
+            int64_t slot = table_find_or_put(&search->table, successor, &added);
+
+            if (slot < 0) {
+                __atomic_store_n(&search->full, 1, __ATOMIC_RELAXED);
+                break;
+            }
+
+            if (added) search->next[__atomic_fetch_add(&search->next_count, 1, __ATOMIC_RELAXED)] = slot;
+        }
+    }
+
+    free(enabled);
+    free(stack);
+    free(in_set);
+
+    __atomic_fetch_add(&search->transitions, fired, __ATOMIC_RELAXED);
+}
+
+int explicit_reach(explicit_net_t *net, size_t memory, explicit_stats_t *stats) {
+    return explicit_find(net, memory, NULL, 0, stats);
+}
+
+/*
+ * The markings of a level are checked against the goal when they are expanded, so the search ends
+ * in the level after the one the first goal marking is found in.
+ */
+int explicit_find(explicit_net_t *net, size_t memory, ctl_node_t *goal, int reduce, explicit_stats_t *stats) {
+    LACE_ME;
+
+    search_t search;
+    search.net = net;
+    search.goal = goal;
+    search.reduce = reduce && goal != NULL;
+    search.found = 0;
+    search.table.num_words = net->num_words;
+
+    // a slot takes a bucket, a marking, and its index in both frontiers
+    size_t slot_size = sizeof(uint64_t) * (net->num_words + 1) + 2 * sizeof(size_t);
+    search.table.capacity = 1;
+    while (search.table.capacity * 2 * slot_size <= memory) search.table.capacity *= 2;
+    search.table.count = 0;
+    search.table.limit = search.table.capacity - search.table.capacity * (100 - MAX_LOAD) / 100;
+
+    search.table.buckets = calloc(search.table.capacity, sizeof(uint64_t));
+    search.table.data = mmalloc(search.table.capacity * net->num_words * sizeof(uint64_t));
+    search.frontier = mmalloc(search.table.capacity * sizeof(size_t));
+    search.next = mmalloc(search.table.capacity * sizeof(size_t));
+    search.transitions = 0;
+    search.full = 0;
+
+    if (search.table.buckets == NULL) {
+        warn("Unable to allocate %zu buckets", search.table.capacity);
+        exit(1);
+    }
+
+    warn("Explicit hash table of %zu markings of %d words", search.table.capacity, net->num_words);
+
+    double start = wctime();
+
+    int added;
+    search.frontier[0] = table_find_or_put(&search.table, net->initial, &added);
+    size_t frontier_count = 1;
+
+    stats->states = 1;
+    stats->levels = 0;
+
+    while (frontier_count > 0 && !search.full && !search.found) {
+        double t = wctime();
+
+        search.next_count = 0;
+        CALL(explore_range, &search, 0, frontier_count);
+
+        size_t *swap = search.frontier;
+        search.frontier = search.next;
+        search.next = swap;
+        frontier_count = search.next_count;
+
+        stats->states += frontier_count;
+        stats->levels++;
+
+        warn("Explicit BFS level %d: %.3f s, %zu new states", stats->levels, wctime() - t, frontier_count);
+    }
+
+    stats->transitions = search.transitions;
+    stats->time = wctime() - start;
+    stats->workers = lace_workers();
+    stats->complete = !search.full;
+    stats->found = search.found;
+
+    if (search.full) warn("The explicit hash table is %d%% full after %llu states", MAX_LOAD,
+            (unsigned long long) stats->states);
+
+    free(search.table.buckets);
+    free(search.table.data);
+    free(search.frontier);
+    free(search.next);
+
+    return search.full && !search.found;
+}
@@ -0,0 +1,104 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "andl.h"
+#include "ctl.h"
+
+#ifndef EXPLICIT_H
+#define EXPLICIT_H
+
+/**
+ * A 1-safe net for explicit-state exploration. A marking is packed in a bit vector of num_words
+ * words, with bit i for the i-th place of the net. A transition is a pair of masks over the same
+ * words: the places it consumes from and the places it produces in.
+ */
+typedef struct {
+    int num_places;
+    int num_words;
+
+    uint64_t *initial;
+
+    int num_transitions;
+
+    // the input and output places of transition t start at word t * num_words
+    uint64_t *pre;
+    uint64_t *post;
+
+    // like in the BDD encoding, a transition that consumes from and produces in the same place
+    // never fires, although it is enabled
+    char *fires;
+
+    // the transitions that produce in place p are producers[producer_start[p]] up to
+    // producers[producer_start[p + 1]], and likewise for the transitions that consume from p
+    int *producer_start;
+    int *producers;
+    int *consumer_start;
+    int *consumers;
+} explicit_net_t;
+
+/**
+ * Packs the 1-safe net in \p andl_context.
+ */
+explicit_net_t *explicit_build_net(andl_context_t *andl_context);
+
+void explicit_free_net(explicit_net_t *net);
+
+/**
+ * \return: whether all input places of transition \p t are marked in \p marking.
+ */
+int explicit_enabled(explicit_net_t *net, const uint64_t *marking, int t);
+
+/**
+ * Stores the marking after firing the enabled transition \p t in \p marking in \p result.
+ */
+void explicit_fire(explicit_net_t *net, const uint64_t *marking, int t, uint64_t *result);
+
+/**
+ * \return: whether \p marking satisfies \p formula, a formula without temporal operators.
+ */
+int explicit_eval(explicit_net_t *net, ctl_node_t *formula, const uint64_t *marking);
+
+/**
+ * \return: whether \p formula has no temporal operators, so explicit_eval can evaluate it.
+ */
+int explicit_is_state_formula(ctl_node_t *formula);
+
+/**
+ * \return: a hash of the \p num_words words of \p marking, different for every \p seed.
+ */
+uint64_t explicit_hash(const uint64_t *marking, int num_words, uint64_t seed);
+
+/**
+ * The outcome of an explicit exploration.
+ */
+typedef struct {
+    // the number of distinct markings found, and the number of times a transition fired
+    uint64_t states;
+    uint64_t transitions;
+
+    // whether a marking satisfying the goal was found
+    int found;
+
+    int levels;
+    double time;
+    int workers;
+
+    // 0 if the memory ran out before all reachable markings were found
+    int complete;
+} explicit_stats_t;
+
+/**
+ * Computes the reachable markings of \p net by a breadth-first search on all Lace workers, storing
+ * them in a lock-free hash table that takes at most \p memory bytes.
+ * \return: 0 if all reachable markings were found, 1 if the table filled up.
+ */
+int explicit_reach(explicit_net_t *net, size_t memory, explicit_stats_t *stats);
+
+/**
+ * Like explicit_reach, but stops as soon as a marking satisfies \p goal, a formula for which
+ * explicit_is_state_formula holds. With \p reduce, only the enabled transitions of a stubborn set
+ * for the goal are fired, which preserves whether a goal marking is reachable.
+ * \return: 0 if the goal was found or all reachable markings were explored, 1 if the table filled up.
+ */
+int explicit_find(explicit_net_t *net, size_t memory, ctl_node_t *goal, int reduce, explicit_stats_t *stats);
+
+#endif
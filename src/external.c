@@ -0,0 +1,399 @@
+#include "external.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "util.h"
+
+// the most files merged at once, so the number of open files stays small
+#define MERGE_WAYS 64
+
+// the buffer of a file that a merge aims for, in bytes; fewer files are merged at once to get it
+#define MIN_BUFFER (64 * 1024)
+
+/*
+ * The state of the search: where its files go, and the statistics of the reads and writes.
+ */
+typedef struct {
+    explicit_net_t *net;
+
+    // the size of a marking in bytes
+    size_t bytes;
+
+    const char *directory;
+    int next_file;
+
+    external_stats_t *stats;
+} external_t;
+
+/*
+ * A file of markings in increasing order, or the name of one.
+ */
+typedef struct {
+    char *name;
+    uint64_t count;
+} run_t;
+
+// the size of the markings qsort compares
+static size_t marking_bytes;
+
+static int compare_markings(const void *a, const void *b) {
+    return memcmp(a, b, marking_bytes);
+}
+
+static run_t new_run(external_t *external) {
+    run_t run;
+    size_t size = strlen(external->directory) + 64;
+
+    run.name = mmalloc(size);
+    snprintf(run.name, size, "%s/ss-%d-%d.run", external->directory, (int) getpid(), external->next_file++);
+    run.count = 0;
+
+    return run;
+}
+
+static void delete_run(run_t *run) {
+    remove(run->name);
+    free(run->name);
+}
+
+static FILE *open_run(run_t *run, const char *mode) {
+    FILE *file = fopen(run->name, mode);
+
+    if (file == NULL) {
+        warn("Unable to open '%s'", run->name);
+        exit(1);
+    }
+
+    return file;
+}
+
+static void write_markings(external_t *external, FILE *file, const uint64_t *markings, size_t count) {
+    double start = wctime();
+
+    if (fwrite(markings, external->bytes, count, file) != count) {
+        warn("Unable to write %zu markings to disk", count);
+        exit(1);
+    }
+
+    external->stats->bytes_written += count * external->bytes;
+    external->stats->io_time += wctime() - start;
+}
+
+static size_t read_markings(external_t *external, FILE *file, uint64_t *markings, size_t count) {
+    double start = wctime();
+
+    size_t read = fread(markings, external->bytes, count, file);
+
+    external->stats->bytes_read += read * external->bytes;
+    external->stats->io_time += wctime() - start;
+
+    return read;
+}
+
+/*
+ * Sorts the \p count markings in \p markings, and writes them without duplicates to a new run.
+ */
+static run_t spill(external_t *external, uint64_t *markings, size_t count) {
+    size_t words = external->bytes / sizeof(uint64_t);
+    size_t unique = 0;
+
+    marking_bytes = external->bytes;
+    qsort(markings, count, external->bytes, compare_markings);
+
+    for (size_t i = 0; i < count; i++) {
+        if (unique > 0 && memcmp(markings + (unique - 1) * words, markings + i * words, external->bytes) == 0) continue;
+
+        memmove(markings + unique * words, markings + i * words, external->bytes);
+        unique++;
+    }
+
+    run_t run = new_run(external);
+    FILE *file = open_run(&run, "wb");
+    write_markings(external, file, markings, unique);
+    fclose(file);
+
+    run.count = unique;
+    external->stats->runs++;
+
+    return run;
+}
+
+/*
+ * Reads a run through a buffer, one marking at a time.
+ */
+typedef struct {
+    FILE *file;
+    uint64_t *buffer;
+    size_t capacity;
+    size_t count;
+    size_t position;
+} reader_t;
+
+static void open_reader(external_t *external, reader_t *reader, run_t *run, size_t buffer_bytes) {
+    reader->file = open_run(run, "rb");
+    reader->capacity = buffer_bytes / external->bytes;
+    if (reader->capacity == 0) reader->capacity = 1;
+    reader->buffer = mmalloc(reader->capacity * external->bytes);
+    reader->count = 0;
+    reader->position = 0;
+}
+
+/*
+ * \return: the current marking of \p reader, or NULL at the end of its run.
+ */
+static uint64_t *reader_head(external_t *external, reader_t *reader) {
+    if (reader->position == reader->count) {
+        reader->count = read_markings(external, reader->file, reader->buffer, reader->capacity);
+        reader->position = 0;
+
+        if (reader->count == 0) return NULL;
+    }
+
+    return reader->buffer + reader->position * (external->bytes / sizeof(uint64_t));
+}
+
+static void close_reader(reader_t *reader) {
+    fclose(reader->file);
+    free(reader->buffer);
+}
+
+/*
+ * Collects markings in a buffer, and writes them to a run when it is full.
+ */
+typedef struct {
+    FILE *file;
+    uint64_t *buffer;
+    size_t capacity;
+    size_t count;
+    run_t *run;
+} writer_t;
+
+static void open_writer(external_t *external, writer_t *writer, run_t *run, size_t buffer_bytes) {
+    writer->file = open_run(run, "wb");
+    writer->capacity = buffer_bytes / external->bytes;
+    if (writer->capacity == 0) writer->capacity = 1;
+    writer->buffer = mmalloc(writer->capacity * external->bytes);
+    writer->count = 0;
+    writer->run = run;
+}
+
+static void writer_put(external_t *external, writer_t *writer, const uint64_t *marking) {
+    if (writer->count == writer->capacity) {
+        write_markings(external, writer->file, writer->buffer, writer->count);
+        writer->count = 0;
+    }
+
+    memcpy(writer->buffer + writer->count * (external->bytes / sizeof(uint64_t)), marking, external->bytes);
+    writer->count++;
+    writer->run->count++;
+}
+
+static void close_writer(external_t *external, writer_t *writer) {
+    write_markings(external, writer->file, writer->buffer, writer->count);
+    fclose(writer->file);
+    free(writer->buffer);
+}
+
+/*
+ * Merges the \p num_runs runs into one run without duplicates, and deletes them. With \p visited,
+ * the markings in that run are left out of the result, and the result is also added to a new run
+ * of visited markings that replaces it. The buffers of all files share the \p memory bytes.
+ */
+static run_t merge(external_t *external, run_t *runs, int num_runs, run_t *visited, size_t memory) {
+    int num_inputs = num_runs + (visited != NULL);
+    int num_outputs = 1 + (visited != NULL);
+
+    size_t buffer_bytes = memory / (num_inputs + num_outputs);
+
+    reader_t *readers = mmalloc(num_inputs * sizeof(reader_t));
+    uint64_t **heads = mmalloc(num_inputs * sizeof(uint64_t *));
+
+    for (int i = 0; i < num_runs; i++) open_reader(external, readers + i, runs + i, buffer_bytes);
+    if (visited != NULL) open_reader(external, readers + num_runs, visited, buffer_bytes);
+
+    for (int i = 0; i < num_inputs; i++) heads[i] = reader_head(external, readers + i);
+
+    run_t result = new_run(external);
+    run_t all = { NULL, 0 };
+    writer_t result_writer, all_writer;
+
+    open_writer(external, &result_writer, &result, buffer_bytes);
+    if (visited != NULL) {
+        all = new_run(external);
+        open_writer(external, &all_writer, &all, buffer_bytes);
+    }
+
+    uint64_t *smallest = mmalloc(external->bytes);
+
+    for (;;) {
+        int first = -1;
+
+        for (int i = 0; i < num_inputs; i++) {
+            if (heads[i] == NULL) continue;
+            if (first == -1 || memcmp(heads[i], heads[first], external->bytes) < 0) first = i;
+        }
+
+        if (first == -1) break;
+
+        memcpy(smallest, heads[first], external->bytes);
+
+        // every run is sorted and has no duplicates, so each run holds the marking at most once
+        int seen = 0;
+
+        for (int i = 0; i < num_inputs; i++) {
+            if (heads[i] == NULL || memcmp(heads[i], smallest, external->bytes) != 0) continue;
+
+            if (visited != NULL && i == num_runs) seen = 1;
+
+            readers[i].position++;
+            heads[i] = reader_head(external, readers + i);
+        }
+
+        if (!seen) writer_put(external, &result_writer, smallest);
+        if (visited != NULL) writer_put(external, &all_writer, smallest);
+    }
+
+    free(smallest);
+
+    for (int i = 0; i < num_inputs; i++) close_reader(readers + i);
+    for (int i = 0; i < num_runs; i++) delete_run(runs + i);
+
+    close_writer(external, &result_writer);
+    if (visited != NULL) {
+        close_writer(external, &all_writer);
+        delete_run(visited);
+        *visited = all;
+    }
+
+    free(readers);
+    free(heads);
+
+    return result;
+}
+
+/*
+ * Expands the markings of \p layer, and returns the runs of their successors in \p runs.
+ * A quarter of the memory holds a chunk of the layer, the rest the successors.
+ */
+static int expand(external_t *external, run_t *layer, run_t **runs, int *runs_capacity, size_t memory) {
+    explicit_net_t *net = external->net;
+    size_t words = (size_t) net->num_words;
+    int num_runs = 0;
+
+    reader_t reader;
+    open_reader(external, &reader, layer, memory / 4);
+
+    size_t capacity = (memory - memory / 4) / external->bytes;
+    if (capacity < (size_t) net->num_transitions + 1) capacity = net->num_transitions + 1;
+    uint64_t *successors = mmalloc(capacity * external->bytes);
+    size_t count = 0;
+
+    for (uint64_t *marking = reader_head(external, &reader); marking != NULL; marking = reader_head(external, &reader)) {
+        // make room for all successors of the marking
+        if (count + net->num_transitions > capacity) {
+            if (num_runs == *runs_capacity) {
+                *runs_capacity *= 2;
+                *runs = rrealloc(*runs, *runs_capacity * sizeof(run_t));
+            }
+
+            (*runs)[num_runs++] = spill(external, successors, count);
+            count = 0;
+        }
+
+        for (int t = 0; t < net->num_transitions; t++) {
+            if (!net->fires[t] || !explicit_enabled(net, marking, t)) continue;
+
+            explicit_fire(net, marking, t, successors + count * words);
+            count++;
+            external->stats->transitions++;
+        }
+
+        reader.position++;
+    }
+
+    if (count > 0) {
+        if (num_runs == *runs_capacity) {
+            *runs_capacity *= 2;
+            *runs = rrealloc(*runs, *runs_capacity * sizeof(run_t));
+        }
+
+        (*runs)[num_runs++] = spill(external, successors, count);
+    }
+
+    close_reader(&reader);
+    free(successors);
+
+    return num_runs;
+}
+
+void external_reach(explicit_net_t *net, size_t memory, const char *directory, external_stats_t *stats) {
+    external_t external;
+    external.net = net;
+    external.bytes = net->num_words * sizeof(uint64_t);
+    external.directory = directory;
+    external.next_file = 0;
+    external.stats = stats;
+
+    memset(stats, 0, sizeof(external_stats_t));
+
+    double start = wctime();
+
+    run_t layer = new_run(&external);
+    FILE *file = open_run(&layer, "wb");
+    write_markings(&external, file, net->initial, 1);
+    fclose(file);
+    layer.count = 1;
+
+    run_t visited = new_run(&external);
+    file = open_run(&visited, "wb");
+    write_markings(&external, file, net->initial, 1);
+    fclose(file);
+    visited.count = 1;
+
+    stats->states = 1;
+
+    // the runs merged at once, so that their files and the two outputs each get a buffer of
+    // MIN_BUFFER bytes, and the visited run one more in the last merge of a level
+    size_t buffers = memory / MIN_BUFFER;
+    int ways = buffers > MERGE_WAYS + 3 ? MERGE_WAYS : (int) buffers - 3;
+    if (ways < 2) ways = 2;
+
+    int runs_capacity = MERGE_WAYS;
+    run_t *runs = mmalloc(runs_capacity * sizeof(run_t));
+
+    while (layer.count > 0) {
+        double t = wctime();
+
+        int num_runs = expand(&external, &layer, &runs, &runs_capacity, memory);
+        delete_run(&layer);
+
+        // merge the runs in passes, until few enough are left to merge them with the visited ones
+        while (num_runs > ways) {
+            int merged = 0;
+
+            for (int i = 0; i < num_runs; i += ways) {
+                int count = num_runs - i < ways ? num_runs - i : ways;
+                runs[merged++] = merge(&external, runs + i, count, NULL, memory);
+            }
+
+            num_runs = merged;
+        }
+
+        layer = merge(&external, runs, num_runs, &visited, memory);
+
+        stats->states += layer.count;
+        stats->levels++;
+
+        warn("External BFS level %d: %.3f s, %llu new states, %llu visited", stats->levels, wctime() - t,
+                (unsigned long long) layer.count, (unsigned long long) visited.count);
+    }
+
+    delete_run(&layer);
+    delete_run(&visited);
+    free(runs);
+
+    stats->time = wctime() - start;
+}
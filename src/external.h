@@ -0,0 +1,38 @@
+#include <stddef.h>
+#include <stdint.h>
+#include "explicit.h"
+
+#ifndef EXTERNAL_H
+#define EXTERNAL_H
+
+/**
+ * The outcome of an external-memory search.
+ */
+typedef struct {
+    // the number of distinct markings found, and the number of times a transition fired
+    uint64_t states;
+    uint64_t transitions;
+
+    int levels;
+
+    // the number of sorted runs of successors written to disk
+    int runs;
+
+    // the bytes moved to and from disk, and the time it took
+    uint64_t bytes_written;
+    uint64_t bytes_read;
+    double io_time;
+
+    double time;
+} external_stats_t;
+
+/**
+ * Computes the reachable markings of \p net by a breadth-first search that keeps its markings on
+ * disk, in files in \p directory, and uses at most about \p memory bytes of memory for them. The
+ * frontier is read back in chunks, its successors are sorted in memory and spilled to disk as runs,
+ * and the runs are merged with the sorted file of the visited markings, which removes the markings
+ * that were found before. Exits when a file cannot be written.
+ */
+void external_reach(explicit_net_t *net, size_t memory, const char *directory, external_stats_t *stats);
+
+#endif
@@ -0,0 +1,417 @@
+#include "invariant.h"
+
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+/*
+ * The P-semiflows are computed with the Farkas algorithm. Every row holds a combination of
+ * places: its effect on every transition, followed by the weight of every place. The rows start
+ * as the single places, and the transitions are eliminated one at a time, by replacing the rows
+ * with a nonzero effect on the transition by all positive combinations of a row with a positive
+ * and a row with a negative effect that cancel out. Only rows with a minimal support are kept.
+ * The number of rows can grow exponentially, so the computation gives up above a fixed size, and
+ * when a coefficient does not fit in an int.
+ */
+
+// the maximum number of integers in all rows together
+#define FARKAS_MAX_ENTRIES (1 << 25)
+
+typedef struct {
+    int num_places;
+    int num_transitions;
+
+    // the number of integers and of support words of a row
+    int width;
+    int words;
+} farkas_t;
+
+typedef struct {
+    int *values;
+    uint64_t *support;
+} farkas_row_t;
+
+static int gcd(int a, int b) {
+    if (a < 0) a = -a;
+    if (b < 0) b = -b;
+
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+
+    return a;
+}
+
+static farkas_row_t new_row(farkas_t *f) {
+    farkas_row_t row;
+    row.values = calloc(f->width, sizeof(int));
+    row.support = calloc(f->words, sizeof(uint64_t));
+    return row;
+}
+
+static void free_row(farkas_row_t *row) {
+    free(row->values);
+    free(row->support);
+}
+
+// whether the support of a is contained in the support of b
+static int support_subset(farkas_t *f, farkas_row_t *a, farkas_row_t *b) {
+    for (int i = 0; i < f->words; i++) {
+        if ((a->support[i] & ~b->support[i]) != 0) return 0;
+    }
+
+    return 1;
+}
+
+/*
+ * Keep only the rows whose support does not contain the support of another row. Of rows with the
+ * same support, the first is kept.
+ */
+static int keep_minimal(farkas_t *f, farkas_row_t *rows, int num_rows) {
+    char *removed = calloc(num_rows + 1, 1);
+
+    for (int i = 0; i < num_rows; i++) {
+        for (int j = 0; j < num_rows && !removed[i]; j++) {
+            if (i == j || removed[j] || !support_subset(f, rows + j, rows + i)) continue;
+
+            // equal supports keep the first row
+            if (support_subset(f, rows + i, rows + j) && j > i) continue;
+
+            removed[i] = 1;
+        }
+    }
+
+    int n = 0;
+
+    for (int i = 0; i < num_rows; i++) {
+        if (removed[i]) {
+            free_row(rows + i);
+        } else {
+            rows[n++] = rows[i];
+        }
+    }
+
+    free(removed);
+    return n;
+}
+
+/*
+ * Eliminate transition t from the rows. Returns the new number of rows, or -1 if there would be
+ * too many, or a coefficient would overflow. The rows are left unchanged in both cases.
+ */
+static int eliminate(farkas_t *f, farkas_row_t **rows, int num_rows, int t, int max_rows) {
+    int num_zero = 0, num_pos = 0, num_neg = 0;
+
+    for (int i = 0; i < num_rows; i++) {
+        int v = (*rows)[i].values[t];
+
+        if (v == 0) num_zero++;
+        else if (v > 0) num_pos++;
+        else num_neg++;
+    }
+
+    if ((long) num_zero + (long) num_pos * num_neg > max_rows) return -1;
+
+    farkas_row_t *next = mmalloc((num_zero + num_pos * num_neg + 1) * sizeof(farkas_row_t));
+    int n = 0;
+
+    for (int i = 0; i < num_rows; i++) {
+        if ((*rows)[i].values[t] == 0) next[n++] = (*rows)[i];
+    }
+
+    int overflow = 0;
+
+    for (int i = 0; i < num_rows; i++) {
+        farkas_row_t *a = *rows + i;
+        if (a->values[t] <= 0) continue;
+
+        for (int j = 0; j < num_rows; j++) {
+            farkas_row_t *b = *rows + j;
+            if (b->values[t] >= 0) continue;
+
+            int g = gcd(a->values[t], b->values[t]);
+            int scale_a = -b->values[t] / g;
+            int scale_b = a->values[t] / g;
+
+            farkas_row_t row = new_row(f);
+            int common = 0;
+
+            for (int k = 0; k < f->width && !overflow; k++) {
+                int from_a, from_b;
+
+                // INT_MIN has no positive counterpart, so gcd could not handle it
+                overflow = __builtin_mul_overflow(scale_a, a->values[k], &from_a) ||
+                        __builtin_mul_overflow(scale_b, b->values[k], &from_b) ||
+                        __builtin_add_overflow(from_a, from_b, row.values + k) || row.values[k] == INT_MIN;
+
+                if (!overflow) common = gcd(common, row.values[k]);
+            }
+
+            if (overflow) {
+                free_row(&row);
+
+                // the rows with a zero effect are still in the old rows
+                for (int i = num_zero; i < n; i++) free_row(next + i);
+                free(next);
+
+                return -1;
+            }
+
+            for (int k = 0; k < f->width; k++) {
+                if (common > 1) row.values[k] /= common;
+            }
+
+            for (int k = 0; k < f->words; k++) {
+                row.support[k] = a->support[k] | b->support[k];
+            }
+
+            next[n++] = row;
+        }
+    }
+
+    for (int i = 0; i < num_rows; i++) {
+        if ((*rows)[i].values[t] != 0) free_row(*rows + i);
+    }
+
+    free(*rows);
+    *rows = next;
+
+    return keep_minimal(f, next, n);
+}
+
+/*
+ * Compute the minimal P-semiflows. Returns the number of semiflows stored in \p semiflows, or -1
+ * if there were too many rows.
+ */
+static int compute_semiflows(andl_context_t *andl_context, farkas_row_t **semiflows) {
+    farkas_t f;
+    f.num_places = andl_context->num_places;
+    f.num_transitions = andl_context->num_transitions;
+    f.width = f.num_transitions + f.num_places;
+    f.words = (f.num_places + 63) / 64;
+
+    int max_rows = FARKAS_MAX_ENTRIES / (f.width + 1);
+    if (f.num_places > max_rows) return -1;
+
+    farkas_row_t *rows = mmalloc((f.num_places + 1) * sizeof(farkas_row_t));
+
+    for (int p = 0; p < f.num_places; p++) {
+        rows[p] = new_row(&f);
+        rows[p].values[f.num_transitions + p] = 1;
+        rows[p].support[p / 64] |= 1ULL << (p % 64);
+    }
+
+    for (int t = 0; t < f.num_transitions; t++) {
+        transition_t *transition = andl_context->transitions + t;
+
+        for (int i = 0; i < transition->num_arcs; i++) {
+            int p = transition->arcs[i].place->identifier;
+            int weight = transition->arcs[i].weight;
+            rows[p].values[t] += transition->arcs[i].dir == ARC_IN ? -weight : weight;
+        }
+    }
+
+    int num_rows = f.num_places;
+    char *done = calloc(f.num_transitions + 1, 1);
+
+    for (int step = 0; step < f.num_transitions && num_rows >= 0; step++) {
+        // eliminate the transition that creates the fewest combinations first
+        int best = -1;
+        long best_cost = 0;
+
+        for (int t = 0; t < f.num_transitions; t++) {
+            if (done[t]) continue;
+
+            long pos = 0, neg = 0;
+
+            for (int i = 0; i < num_rows; i++) {
+                if (rows[i].values[t] > 0) pos++;
+                if (rows[i].values[t] < 0) neg++;
+            }
+
+            if (best == -1 || pos * neg - pos - neg < best_cost) {
+                best = t;
+                best_cost = pos * neg - pos - neg;
+            }
+        }
+
+        done[best] = 1;
+
+        int n = eliminate(&f, &rows, num_rows, best, max_rows);
+
+        if (n < 0) {
+            for (int i = 0; i < num_rows; i++) free_row(rows + i);
+            free(rows);
+            rows = NULL;
+        }
+
+        num_rows = n;
+    }
+
+    free(done);
+
+    *semiflows = rows;
+    return num_rows;
+}
+
+/*
+ * Whether the places with a nonzero weight in \p weights keep their total number of tokens when
+ * any transition fires, checked on the arcs of the net rather than trusted from the Farkas rows.
+ */
+static int is_invariant(andl_context_t *andl_context, const int *weights) {
+    for (int t = 0; t < andl_context->num_transitions; t++) {
+        transition_t *transition = andl_context->transitions + t;
+        long effect = 0;
+
+        for (int i = 0; i < transition->num_arcs; i++) {
+            long weight = (long) weights[transition->arcs[i].place->identifier] * transition->arcs[i].weight;
+            effect += transition->arcs[i].dir == ARC_IN ? -weight : weight;
+        }
+
+        if (effect != 0) return 0;
+    }
+
+    return 1;
+}
+
+static int compare_size(const void *a, const void *b) {
+    return ((const int *) b)[0] - ((const int *) a)[0];
+}
+
+static int compare_place_level(const void *a, const void *b) {
+    return (*(place_t * const *) a)->level - (*(place_t * const *) b)->level;
+}
+
+int encode_invariants(andl_context_t *andl_context) {
+    int num_places = andl_context->num_places;
+    int num_transitions = andl_context->num_transitions;
+
+    double start = wctime();
+
+    farkas_row_t *semiflows;
+    int num_semiflows = compute_semiflows(andl_context, &semiflows);
+
+    if (num_semiflows < 0) {
+        warn("P-invariants: too many semiflows or too large coefficients, every place keeps a level of its own");
+        return num_places;
+    }
+
+    // the one-hot semiflows, as (size, index) pairs
+    int *candidates = mmalloc((2 * num_semiflows + 2) * sizeof(int));
+    int num_candidates = 0;
+
+    for (int i = 0; i < num_semiflows; i++) {
+        int *weights = semiflows[i].values + num_transitions;
+        int size = 0, tokens = 0, binary = 1;
+
+        for (int p = 0; p < num_places; p++) {
+            if (weights[p] == 0) continue;
+            if (weights[p] != 1) binary = 0;
+
+            size++;
+            tokens += andl_context->places[p].initial_marking;
+        }
+
+        if (!binary || tokens != 1 || size < 2) continue;
+
+        // a wrong group would merge places that are marked together, so it is checked on the arcs
+        if (!is_invariant(andl_context, weights)) {
+            warn("P-invariants: semiflow %d does not hold on the net, it is skipped", i);
+            continue;
+        }
+
+        candidates[2 * num_candidates] = size;
+        candidates[2 * num_candidates + 1] = i;
+        num_candidates++;
+    }
+
+    // pick disjoint groups, the largest first as they save the most levels
+    qsort(candidates, num_candidates, 2 * sizeof(int), compare_size);
+
+    int *group_of = mmalloc((num_places + 1) * sizeof(int));
+    for (int p = 0; p < num_places; p++) group_of[p] = -1;
+
+    int num_groups = 0, grouped = 0;
+
+    for (int c = 0; c < num_candidates; c++) {
+        int *weights = semiflows[candidates[2 * c + 1]].values + num_transitions;
+        int disjoint = 1;
+
+        for (int p = 0; p < num_places; p++) {
+            if (weights[p] != 0 && group_of[p] != -1) disjoint = 0;
+        }
+
+        if (!disjoint) continue;
+
+        for (int p = 0; p < num_places; p++) {
+            if (weights[p] != 0) group_of[p] = num_groups;
+        }
+
+        grouped += candidates[2 * c];
+        num_groups++;
+    }
+
+    // assign the levels in the current order; a group takes the position of its top-most place
+    place_t **sorted = mmalloc((num_places + 1) * sizeof(place_t *));
+    for (int p = 0; p < num_places; p++) sorted[p] = andl_context->places + p;
+    qsort(sorted, num_places, sizeof(place_t *), compare_place_level);
+
+    int *group_level = mmalloc((num_groups + 1) * sizeof(int));
+    int *group_size = calloc(num_groups + 1, sizeof(int));
+    int *group_bits = mmalloc((num_groups + 1) * sizeof(int));
+
+    for (int g = 0; g < num_groups; g++) group_level[g] = -1;
+
+    for (int p = 0; p < num_places; p++) {
+        if (group_of[p] != -1) group_size[group_of[p]]++;
+    }
+
+    for (int g = 0; g < num_groups; g++) {
+        group_bits[g] = 0;
+        while ((1 << group_bits[g]) < group_size[g]) group_bits[g]++;
+        group_size[g] = 0;
+    }
+
+    int num_levels = 0;
+
+    for (int i = 0; i < num_places; i++) {
+        place_t *place = sorted[i];
+        int g = group_of[place->identifier];
+
+        if (g == -1) {
+            place->level = num_levels++;
+            place->bits = 0;
+            place->code = 0;
+            continue;
+        }
+
+        if (group_level[g] == -1) {
+            group_level[g] = num_levels;
+            num_levels += group_bits[g];
+        }
+
+        place->level = group_level[g];
+        place->bits = group_bits[g];
+        place->code = group_size[g]++;
+    }
+
+    warn("P-invariants: %d minimal semiflows, %d one-hot groups covering %d places, %.3f s", num_semiflows,
+            num_groups, grouped, wctime() - start);
+    warn("Encoding the %d places in %d levels", num_places, num_levels);
+
+    for (int i = 0; i < num_semiflows; i++) free_row(semiflows + i);
+    free(semiflows);
+    free(candidates);
+    free(group_of);
+    free(sorted);
+    free(group_level);
+    free(group_size);
+    free(group_bits);
+
+    return num_levels;
+}
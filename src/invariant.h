@@ -0,0 +1,17 @@
+#include "andl.h"
+
+#ifndef INVARIANT_H
+#define INVARIANT_H
+
+/**
+ * Computes the P-semiflows of the net in \p andl_context, the weightings of the places whose
+ * weighted sum of tokens no transition changes. The semiflows with weight 1 on all their places
+ * and a single token in the initial marking are one-hot groups: exactly one of their places is
+ * marked in every reachable marking. Disjoint groups are encoded in logarithmically many levels,
+ * by setting the level, bits and code of their places; the other places keep a level of their
+ * own. The groups are placed at the position of their top-most place in the current order.
+ * \return: the number of levels of the encoding.
+ */
+int encode_invariants(andl_context_t *andl_context);
+
+#endif
@@ -0,0 +1,515 @@
+#include "ldd.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+// the values of the meta of lddmc_relprod and the projections of lddmc_match
+#define META_SKIP 0
+#define META_READ 1
+#define META_WRITE 2
+#define META_END ((uint32_t) -1)
+
+/*
+ * The tokens a transition consumes from and produces in one place, summed over its arcs.
+ */
+typedef struct {
+    int level;
+    uint32_t in;
+    uint32_t out;
+} ldd_effect_t;
+
+static int compare_effect(const void *a, const void *b) {
+    return ((const ldd_effect_t *) a)->level - ((const ldd_effect_t *) b)->level;
+}
+
+/*
+ * Collect the effect of \p transition on every place it touches, ordered by level.
+ */
+static int collect_effects(transition_t *transition, ldd_effect_t *effects) {
+    int n = 0;
+
+    for (int i = 0; i < transition->num_arcs; i++) {
+        arc_t *arc = transition->arcs + i;
+        int j = 0;
+
+        while (j < n && effects[j].level != arc->place->level) j++;
+
+        if (j == n) {
+            effects[n].level = arc->place->level;
+            effects[n].in = 0;
+            effects[n].out = 0;
+            n++;
+        }
+
+        if (arc->dir == ARC_IN) {
+            effects[j].in += arc->weight;
+        } else {
+            effects[j].out += arc->weight;
+        }
+    }
+
+    qsort(effects, n, sizeof(ldd_effect_t), compare_effect);
+    return n;
+}
+
+/*
+ * The largest number of tokens a place can hold before the transition fires, such that it holds
+ * at most \p bound after, or -1 if there is none.
+ */
+static long last_value(ldd_effect_t *effect, uint32_t bound) {
+    long last = (long) bound - (effect->out > effect->in ? (long) (effect->out - effect->in) : 0);
+    return last < (long) effect->in ? -1 : last;
+}
+
+/*
+ * Make a level with the values from \p first to \p last, all leading to \p down.
+ */
+static MDD make_interval(uint32_t first, uint32_t last, MDD down) {
+    MDD node = lddmc_false;
+    lddmc_protect(&node);
+
+    for (long v = last; v >= (long) first; v--) {
+        node = lddmc_makenode((uint32_t) v, down, node);
+    }
+
+    lddmc_unprotect(&node);
+    return node;
+}
+
+/*
+ * Make the projection that matches or reads and writes the levels in \p levels, given in
+ * increasing order, and skips the others.
+ */
+static MDD make_meta(int *levels, int count, int read_write) {
+    int size = count == 0 ? 1 : (levels[count - 1] + 1) * (read_write ? 2 : 1) + 1;
+    uint32_t *values = mmalloc(size * sizeof(uint32_t));
+    int n = 0;
+
+    for (int l = 0, i = 0; i < count; l++) {
+        if (levels[i] != l) {
+            values[n++] = META_SKIP;
+        } else {
+            values[n++] = META_READ;
+            if (read_write) values[n++] = META_WRITE;
+            i++;
+        }
+    }
+
+    values[n++] = META_END;
+
+    MDD meta = lddmc_cube(values, n);
+    free(values);
+
+    return meta;
+}
+
+static void generate_ldd_relation(transition_t *transition, uint32_t bound, ldd_relation_t *result) {
+    ldd_effect_t *effects = mmalloc((transition->num_arcs + 1) * sizeof(ldd_effect_t));
+    int *levels = mmalloc((transition->num_arcs + 1) * sizeof(int));
+    int *input_levels = mmalloc((transition->num_arcs + 1) * sizeof(int));
+
+    int n = collect_effects(transition, effects);
+    int num_inputs = 0;
+
+    result->relation = lddmc_true;
+    result->enabled = lddmc_true;
+    result->within = lddmc_true;
+    lddmc_protect(&result->relation);
+    lddmc_protect(&result->enabled);
+    lddmc_protect(&result->within);
+
+    // the levels are built bottom-up
+    for (int i = n - 1; i >= 0; i--) {
+        ldd_effect_t *effect = effects + i;
+        long last = last_value(effect, bound);
+
+        if (last == -1) {
+            result->relation = lddmc_false;
+            result->within = lddmc_false;
+        } else {
+            MDD level = lddmc_false;
+            lddmc_protect(&level);
+
+            for (long v = last; v >= (long) effect->in; v--) {
+                MDD write = lddmc_makenode((uint32_t) (v - effect->in + effect->out), result->relation, lddmc_false);
+                level = lddmc_makenode((uint32_t) v, write, level);
+            }
+
+            result->relation = level;
+            result->within = make_interval(effect->in, (uint32_t) last, result->within);
+
+            lddmc_unprotect(&level);
+        }
+
+        if (effect->in > 0) {
+            result->enabled = effect->in > bound ? lddmc_false : make_interval(effect->in, bound, result->enabled);
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        levels[i] = effects[i].level;
+        if (effects[i].in > 0) input_levels[num_inputs++] = effects[i].level;
+    }
+
+    result->meta = make_meta(levels, n, 1);
+    result->enabled_meta = make_meta(input_levels, num_inputs, 0);
+    result->within_meta = make_meta(levels, n, 0);
+    lddmc_protect(&result->meta);
+    lddmc_protect(&result->enabled_meta);
+    lddmc_protect(&result->within_meta);
+
+    free(effects);
+    free(levels);
+    free(input_levels);
+}
+
+static void free_ldd_relations(ldd_relation_t *relations, int num_relations) {
+    for (int i = 0; i < num_relations; i++) {
+        lddmc_unprotect(&relations[i].relation);
+        lddmc_unprotect(&relations[i].meta);
+        lddmc_unprotect(&relations[i].enabled);
+        lddmc_unprotect(&relations[i].enabled_meta);
+        lddmc_unprotect(&relations[i].within);
+        lddmc_unprotect(&relations[i].within_meta);
+    }
+
+    free(relations);
+}
+
+static ldd_relation_t *generate_ldd_relations(andl_context_t *andl_context, uint32_t bound) {
+    ldd_relation_t *relations = mmalloc((andl_context->num_transitions + 1) * sizeof(ldd_relation_t));
+
+    for (int i = 0; i < andl_context->num_transitions; i++) {
+        generate_ldd_relation(andl_context->transitions + i, bound, relations + i);
+    }
+
+    return relations;
+}
+
+ldd_model_t *ldd_build_model(andl_context_t *andl_context, uint32_t bound) {
+    ldd_model_t *model = mmalloc(sizeof(ldd_model_t));
+
+    model->num_levels = andl_context->num_places;
+    model->num_transitions = andl_context->num_transitions;
+
+    uint32_t *marking = mmalloc((model->num_levels + 1) * sizeof(uint32_t));
+
+    for (int i = 0; i < andl_context->num_places; i++) {
+        place_t *place = andl_context->places + i;
+
+        marking[place->level] = place->initial_marking;
+        if ((uint32_t) place->initial_marking > bound) bound = place->initial_marking;
+    }
+
+    model->bound = bound;
+
+    model->initial_state = lddmc_cube(marking, model->num_levels);
+    lddmc_protect(&model->initial_state);
+    free(marking);
+
+    model->transitions = generate_ldd_relations(andl_context, bound);
+
+    model->reachable = lddmc_false;
+    lddmc_protect(&model->reachable);
+
+    return model;
+}
+
+void ldd_free_model(ldd_model_t *model) {
+    lddmc_unprotect(&model->initial_state);
+    lddmc_unprotect(&model->reachable);
+
+    free_ldd_relations(model->transitions, model->num_transitions);
+
+    free(model);
+}
+
+/*
+ * Whether a state in \p states enables a transition that would put more tokens in a place than the
+ * relations of the model represent.
+ */
+static int exceeds_bound(ldd_model_t *model, MDD states) {
+    LACE_ME;
+
+    for (int i = 0; i < model->num_transitions; i++) {
+        ldd_relation_t *relation = model->transitions + i;
+
+        MDD enabled = lddmc_match(states, relation->enabled, relation->enabled_meta);
+        lddmc_protect(&enabled);
+
+        MDD within = lddmc_match(enabled, relation->within, relation->within_meta);
+        int exceeds = within != enabled;
+
+        lddmc_unprotect(&enabled);
+
+        if (exceeds) return 1;
+    }
+
+    return 0;
+}
+
+/*
+ * Chaining, like reach_chaining on BDDs: the output of every transition is fed to the next
+ * transition within the same iteration. When the reachable states enable a transition beyond the
+ * bound, the bound is doubled and all states found so far are explored again with the new
+ * relations.
+ */
+int ldd_reach(ldd_model_t *model, andl_context_t *andl_context) {
+    LACE_ME;
+
+    MDD visited = model->initial_state;
+    MDD frontier = visited;
+    MDD chain = lddmc_false;
+    lddmc_protect(&visited);
+    lddmc_protect(&frontier);
+    lddmc_protect(&chain);
+
+    int counter = 0;
+    int result = 0;
+    double start = wctime();
+
+    while (1) {
+        while (frontier != lddmc_false) {
+            double t = wctime();
+
+            chain = frontier;
+
+            for (int i = 0; i < model->num_transitions; i++) {
+                ldd_relation_t *relation = model->transitions + i;
+                MDD next = lddmc_relprod(chain, relation->relation, relation->meta);
+                lddmc_protect(&next);
+
+                chain = lddmc_union(chain, lddmc_minus(next, visited));
+
+                lddmc_unprotect(&next);
+            }
+
+            frontier = lddmc_minus(chain, visited);
+            visited = lddmc_union(visited, frontier);
+
+            counter++;
+
+            warn("LDD chaining iteration %d: %.3f s, %.0f new states, %zu nodes in the frontier",
+                    counter, wctime() - t, (double) lddmc_satcount(frontier), lddmc_nodecount(frontier));
+        }
+
+        if (!exceeds_bound(model, visited)) break;
+
+        if (model->bound >= LDD_MAX_BOUND) {
+            warn("The net is not bounded by %u tokens per place", model->bound);
+            result = 1;
+            break;
+        }
+
+        model->bound *= 2;
+        warn("A reachable marking exceeds the bound, raising it to %u", model->bound);
+
+        free_ldd_relations(model->transitions, model->num_transitions);
+        model->transitions = generate_ldd_relations(andl_context, model->bound);
+
+        frontier = visited;
+    }
+
+    printf("Number of loops: %d\n", counter);
+    printf("Chaining time: %.3f s\n", wctime() - start);
+
+    model->reachable = visited;
+
+    lddmc_unprotect(&visited);
+    lddmc_unprotect(&frontier);
+    lddmc_unprotect(&chain);
+
+    return result;
+}
+
+int ldd_check(ldd_model_t *model, ctl_node_t *formula) {
+    LACE_ME;
+
+    MDD states = check_LDD(model, formula);
+    lddmc_protect(&states);
+
+    int result = lddmc_minus(model->initial_state, states) == lddmc_false;
+
+    lddmc_unprotect(&states);
+
+    return result;
+}
+
+/*
+ * Compute the reachable predecessors of the given states, as the union of the predecessors under
+ * every transition.
+ */
+MDD ldd_pre(ldd_model_t *model, MDD states) {
+    LACE_ME;
+
+    MDD result = lddmc_false;
+    lddmc_protect(&result);
+
+    for (int i = 0; i < model->num_transitions; i++) {
+        ldd_relation_t *relation = model->transitions + i;
+        MDD previous = lddmc_relprev(states, relation->relation, relation->meta, model->reachable);
+        lddmc_protect(&previous);
+
+        result = lddmc_union(result, previous);
+
+        lddmc_unprotect(&previous);
+    }
+
+    lddmc_unprotect(&result);
+    return result;
+}
+
+MDD check_LDD(ldd_model_t *model, ctl_node_t *formula) {
+    // formulas are shared between all formulas of a run, so their result may already be known
+    if (formula->ldd_result != sylvan_invalid) {
+        return formula->ldd_result;
+    }
+
+    MDD result;
+
+    switch (formula->type) {
+        case CTL_ATOM:
+            result = check_LDD_atom(model, formula);
+            break;
+        case CTL_NEGATION:
+            result = check_LDD_negation(model, formula);
+            break;
+        case CTL_CONJUNCTION:
+            result = check_LDD_conjunction(model, formula);
+            break;
+        case CTL_DISJUNCTION:
+            result = check_LDD_disjunction(model, formula);
+            break;
+        case CTL_EX:
+            result = check_LDD_EX(model, formula);
+            break;
+        case CTL_EU:
+            result = check_LDD_EU(model, formula);
+            break;
+        case CTL_EG:
+            result = check_LDD_EG(model, formula);
+            break;
+        default:
+            printf("Unknown case in check_LDD\n");
+            return lddmc_false;
+    }
+
+    formula->ldd_result = result;
+    lddmc_protect(&formula->ldd_result);
+
+    return result;
+}
+
+MDD check_LDD_atom(ldd_model_t *model, ctl_node_t *formula) {
+    LACE_ME;
+
+    // -1 marks true value
+    if (formula->atom.num_transitions == -1) return model->reachable;
+
+    MDD result = lddmc_false;
+    lddmc_protect(&result);
+
+    for (int i = 0; i < formula->atom.num_transitions; i++) {
+        ldd_relation_t *relation = model->transitions + formula->atom.fireable_transitions[i].identifier;
+
+        MDD enabled = lddmc_match(model->reachable, relation->enabled, relation->enabled_meta);
+        lddmc_protect(&enabled);
+
+        result = lddmc_union(result, enabled);
+
+        lddmc_unprotect(&enabled);
+    }
+
+    lddmc_unprotect(&result);
+    return result;
+}
+
+MDD check_LDD_negation(ldd_model_t *model, ctl_node_t *formula) {
+    LACE_ME;
+
+    return lddmc_minus(model->reachable, check_LDD(model, formula->unary.child));
+}
+
+MDD check_LDD_conjunction(ldd_model_t *model, ctl_node_t *formula) {
+    LACE_ME;
+
+    MDD left = check_LDD(model, formula->binary.left);
+    MDD right = check_LDD(model, formula->binary.right);
+
+    return lddmc_intersect(left, right);
+}
+
+MDD check_LDD_disjunction(ldd_model_t *model, ctl_node_t *formula) {
+    LACE_ME;
+
+    MDD left = check_LDD(model, formula->binary.left);
+    MDD right = check_LDD(model, formula->binary.right);
+
+    return lddmc_union(left, right);
+}
+
+MDD check_LDD_EX(ldd_model_t *model, ctl_node_t *formula) {
+    return ldd_pre(model, check_LDD(model, formula->unary.child));
+}
+
+/*
+ * E[a U b] as a backward search from b through a, that only takes the pre-image of the states
+ * found in the previous iteration.
+ */
+MDD check_LDD_EU(ldd_model_t *model, ctl_node_t *formula) {
+    LACE_ME;
+
+    MDD a = check_LDD(model, formula->binary.left);
+    MDD b = check_LDD(model, formula->binary.right);
+
+    MDD result = b;
+    MDD frontier = b;
+    MDD pre = lddmc_false;
+    MDD step = lddmc_false;
+    lddmc_protect(&result);
+    lddmc_protect(&frontier);
+    lddmc_protect(&pre);
+    lddmc_protect(&step);
+
+    while (frontier != lddmc_false) {
+        pre = ldd_pre(model, frontier);
+        step = lddmc_intersect(pre, a);
+        frontier = lddmc_minus(step, result);
+        result = lddmc_union(result, frontier);
+    }
+
+    lddmc_unprotect(&result);
+    lddmc_unprotect(&frontier);
+    lddmc_unprotect(&pre);
+    lddmc_unprotect(&step);
+
+    return result;
+}
+
+/*
+ * EG a as the greatest fixpoint of Z = a and EX Z.
+ */
+MDD check_LDD_EG(ldd_model_t *model, ctl_node_t *formula) {
+    LACE_ME;
+
+    MDD z = check_LDD(model, formula->unary.child);
+    MDD old = lddmc_false;
+    MDD pre = lddmc_false;
+    lddmc_protect(&z);
+    lddmc_protect(&old);
+    lddmc_protect(&pre);
+
+    while (z != old) {
+        old = z;
+        pre = ldd_pre(model, z);
+        z = lddmc_intersect(z, pre);
+    }
+
+    lddmc_unprotect(&z);
+    lddmc_unprotect(&old);
+    lddmc_unprotect(&pre);
+
+    return z;
+}
@@ -0,0 +1,83 @@
+#include <sylvan.h>
+#include "andl.h"
+#include "ctl.h"
+
+#ifndef LDD_H
+#define LDD_H
+
+/**
+ * The relation of a single transition on list decision diagrams, with one integer level per place.
+ * The relation reads and writes the token counts of the places the transition touches, the other
+ * levels are copied by lddmc_relprod and lddmc_relprev as described by the meta.
+ */
+typedef struct {
+    MDD relation;
+    MDD meta;
+
+    // the token counts of the input places that enable the transition, and the projection that
+    // matches them against states
+    MDD enabled;
+    MDD enabled_meta;
+
+    // the token counts of the touched places from which the transition stays within the bound,
+    // and the projection that matches them against states
+    MDD within;
+    MDD within_meta;
+} ldd_relation_t;
+
+/**
+ * The model of a bounded Petri net on LDDs. Every place has a level of its own, holding its number
+ * of tokens, in the order given by the levels of the places. The relations only count tokens up to
+ * the bound, which is doubled while a reachable marking enables a transition that exceeds it.
+ */
+typedef struct {
+    MDD initial_state;
+
+    ldd_relation_t *transitions;
+    int num_transitions;
+
+    int num_levels;
+
+    // the largest number of tokens in a place the relations represent
+    uint32_t bound;
+
+    // the reachable states, the universe of all formulas; lddmc_false until they are computed
+    MDD reachable;
+} ldd_model_t;
+
+/**
+ * Builds the LDD model of the net in \p andl_context, counting tokens up to at least \p bound.
+ */
+ldd_model_t *ldd_build_model(andl_context_t *andl_context, uint32_t bound);
+
+void ldd_free_model(ldd_model_t *model);
+
+/**
+ * Computes the reachable states of \p model by chaining, raising the bound when needed.
+ * \return: 0 on success, 1 if no bound up to LDD_MAX_BOUND covers the reachable markings.
+ */
+int ldd_reach(ldd_model_t *model, andl_context_t *andl_context);
+
+/**
+ * The largest bound ldd_reach tries before it gives up on the net as unbounded.
+ */
+#define LDD_MAX_BOUND (1u << 16)
+
+/**
+ * Checks whether the initial state of the model satisfies the normalized \p formula, on the
+ * reachable states computed by ldd_reach.
+ */
+int ldd_check(ldd_model_t *model, ctl_node_t *formula);
+
+MDD ldd_pre(ldd_model_t *model, MDD states);
+
+MDD check_LDD(ldd_model_t *model, ctl_node_t *formula);
+MDD check_LDD_atom(ldd_model_t *model, ctl_node_t *formula);
+MDD check_LDD_negation(ldd_model_t *model, ctl_node_t *formula);
+MDD check_LDD_conjunction(ldd_model_t *model, ctl_node_t *formula);
+MDD check_LDD_disjunction(ldd_model_t *model, ctl_node_t *formula);
+MDD check_LDD_EX(ldd_model_t *model, ctl_node_t *formula);
+MDD check_LDD_EU(ldd_model_t *model, ctl_node_t *formula);
+MDD check_LDD_EG(ldd_model_t *model, ctl_node_t *formula);
+
+#endif
@@ -0,0 +1,574 @@
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "order.h"
+#include "util.h"
+
+/*
+ * The place-transition graph of the net, with the transitions adjacent to every place, and the
+ * places adjacent to every place (places are adjacent when they share a transition).
+ */
+typedef struct {
+    int num_places;
+    int num_transitions;
+
+    // the places of transition t are place_of[trans_start[t]] up to place_of[trans_start[t + 1]]
+    int *trans_start;
+    int *place_of;
+
+    // the transitions of place p are trans_of[place_start[p]] up to trans_of[place_start[p + 1]]
+    int *place_start;
+    int *trans_of;
+
+    // the neighbours of place p are adjacent[adj_start[p]] up to adjacent[adj_start[p + 1]]
+    int *adj_start;
+    int *adjacent;
+} order_graph_t;
+
+static void build_graph(andl_context_t *andl_context, order_graph_t *graph) {
+    int n = andl_context->num_places;
+    int m = andl_context->num_transitions;
+
+    graph->num_places = n;
+    graph->num_transitions = m;
+
+    // collect the distinct places of every transition
+    int *mark = mmalloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) mark[i] = -1;
+
+    int num_arcs = 0;
+    for (int t = 0; t < m; t++) num_arcs += andl_context->transitions[t].num_arcs;
+
+    graph->trans_start = mmalloc((m + 1) * sizeof(int));
+    graph->place_of = mmalloc((num_arcs + 1) * sizeof(int));
+
+    int k = 0;
+    for (int t = 0; t < m; t++) {
+        transition_t *transition = andl_context->transitions + t;
+        graph->trans_start[t] = k;
+
+        for (int i = 0; i < transition->num_arcs; i++) {
+            int p = transition->arcs[i].place->identifier;
+
+            if (mark[p] != t) {
+                mark[p] = t;
+                graph->place_of[k++] = p;
+            }
+        }
+    }
+    graph->trans_start[m] = k;
+
+    // invert it into the transitions of every place
+    graph->place_start = calloc(n + 1, sizeof(int));
+    graph->trans_of = mmalloc((k + 1) * sizeof(int));
+
+    for (int i = 0; i < k; i++) graph->place_start[graph->place_of[i] + 1]++;
+    for (int p = 0; p < n; p++) graph->place_start[p + 1] += graph->place_start[p];
+
+    int *fill = mmalloc(n * sizeof(int));
+    memcpy(fill, graph->place_start, n * sizeof(int));
+
+    for (int t = 0; t < m; t++) {
+        for (int i = graph->trans_start[t]; i < graph->trans_start[t + 1]; i++) {
+            graph->trans_of[fill[graph->place_of[i]]++] = t;
+        }
+    }
+
+    // the neighbours of every place, without duplicates
+    for (int i = 0; i < n; i++) mark[i] = -1;
+
+    int adj_size = 16;
+    int num_adj = 0;
+    graph->adj_start = mmalloc((n + 1) * sizeof(int));
+    graph->adjacent = mmalloc(adj_size * sizeof(int));
+
+    for (int p = 0; p < n; p++) {
+        graph->adj_start[p] = num_adj;
+        mark[p] = p;
+
+        for (int i = graph->place_start[p]; i < graph->place_start[p + 1]; i++) {
+            int t = graph->trans_of[i];
+
+            for (int j = graph->trans_start[t]; j < graph->trans_start[t + 1]; j++) {
+                int q = graph->place_of[j];
+
+                if (mark[q] != p) {
+                    mark[q] = p;
+
+                    if (num_adj == adj_size) {
+                        adj_size *= 2;
+                        graph->adjacent = rrealloc(graph->adjacent, adj_size * sizeof(int));
+                    }
+
+                    graph->adjacent[num_adj++] = q;
+                }
+            }
+        }
+    }
+    graph->adj_start[n] = num_adj;
+
+    free(fill);
+    free(mark);
+}
+
+static void free_graph(order_graph_t *graph) {
+    free(graph->trans_start);
+    free(graph->place_of);
+    free(graph->place_start);
+    free(graph->trans_of);
+    free(graph->adj_start);
+    free(graph->adjacent);
+}
+
+/*
+ * The total span of the given order, where level[p] is the position of place p.
+ */
+static long span(order_graph_t *graph, int *level) {
+    long total = 0;
+
+    for (int t = 0; t < graph->num_transitions; t++) {
+        int lo = graph->num_places;
+        int hi = -1;
+
+        for (int i = graph->trans_start[t]; i < graph->trans_start[t + 1]; i++) {
+            int l = level[graph->place_of[i]];
+            if (l < lo) lo = l;
+            if (l > hi) hi = l;
+        }
+
+        if (hi >= lo) total += hi - lo;
+    }
+
+    return total;
+}
+
+typedef struct {
+    double key;
+    int place;
+} order_key_t;
+
+static int compare_keys(const void *a, const void *b) {
+    const order_key_t *x = a;
+    const order_key_t *y = b;
+
+    if (x->key < y->key) return -1;
+    if (x->key > y->key) return 1;
+    return x->place - y->place;
+}
+
+/*
+ * FORCE: every transition pulls its places towards its centre of gravity. Repeatedly move every
+ * place to the average centre of gravity of its transitions, and keep the order with the smallest
+ * span.
+ */
+static void order_force(order_graph_t *graph, int *level) {
+    int n = graph->num_places;
+
+    double *cog = mmalloc((graph->num_transitions + 1) * sizeof(double));
+    order_key_t *keys = mmalloc((n + 1) * sizeof(order_key_t));
+    int *current = mmalloc((n + 1) * sizeof(int));
+
+    memcpy(current, level, n * sizeof(int));
+    long best = span(graph, level);
+
+    // the number of iterations FORCE needs grows roughly logarithmically with the net size
+    int max_iterations = 20;
+    for (int size = n; size > 1; size /= 2) max_iterations += 10;
+
+    for (int iteration = 0; iteration < max_iterations; iteration++) {
+        for (int t = 0; t < graph->num_transitions; t++) {
+            int count = graph->trans_start[t + 1] - graph->trans_start[t];
+            double sum = 0;
+
+            for (int i = graph->trans_start[t]; i < graph->trans_start[t + 1]; i++) {
+                sum += current[graph->place_of[i]];
+            }
+
+            cog[t] = count > 0 ? sum / count : 0;
+        }
+
+        for (int p = 0; p < n; p++) {
+            int count = graph->place_start[p + 1] - graph->place_start[p];
+            double sum = 0;
+
+            for (int i = graph->place_start[p]; i < graph->place_start[p + 1]; i++) {
+                sum += cog[graph->trans_of[i]];
+            }
+
+            keys[p].key = count > 0 ? sum / count : current[p];
+            keys[p].place = p;
+        }
+
+        qsort(keys, n, sizeof(order_key_t), compare_keys);
+
+        for (int i = 0; i < n; i++) current[keys[i].place] = i;
+
+        long s = span(graph, current);
+        if (s < best) {
+            best = s;
+            memcpy(level, current, n * sizeof(int));
+        } else if (s == best) {
+            break;
+        }
+    }
+
+    free(cog);
+    free(keys);
+    free(current);
+}
+
+/*
+ * Breadth-first search over the place adjacency graph from \p start, restricted to places that do
+ * not have a level yet. Fills \p dist, and returns the place furthest away with the smallest
+ * degree.
+ */
+static int bfs_far(order_graph_t *graph, int start, int *dist, int *queue, int *level) {
+    for (int p = 0; p < graph->num_places; p++) dist[p] = -1;
+
+    int head = 0, tail = 0;
+    queue[tail++] = start;
+    dist[start] = 0;
+
+    int far = start;
+
+    while (head < tail) {
+        int p = queue[head++];
+
+        int degree = graph->adj_start[p + 1] - graph->adj_start[p];
+        int far_degree = graph->adj_start[far + 1] - graph->adj_start[far];
+        if (dist[p] > dist[far] || (dist[p] == dist[far] && degree < far_degree)) far = p;
+
+        for (int i = graph->adj_start[p]; i < graph->adj_start[p + 1]; i++) {
+            int q = graph->adjacent[i];
+
+            if (dist[q] == -1 && level[q] == -1) {
+                dist[q] = dist[p] + 1;
+                queue[tail++] = q;
+            }
+        }
+    }
+
+    return far;
+}
+
+/*
+ * Sloan's profile reduction algorithm. Places are numbered starting at a pseudo-peripheral place,
+ * preferring places far from the opposite end of the graph, and places whose numbering adds few
+ * new places to the active front.
+ */
+static void order_sloan(order_graph_t *graph, int *level) {
+    enum { INACTIVE, PREACTIVE, ACTIVE, POSTACTIVE };
+    const int W1 = 1, W2 = 2;
+
+    int n = graph->num_places;
+
+    int *dist = mmalloc((n + 1) * sizeof(int));
+    int *queue = mmalloc((n + 1) * sizeof(int));
+    int *status = mmalloc((n + 1) * sizeof(int));
+    long *priority = mmalloc((n + 1) * sizeof(long));
+    int *candidates = mmalloc((n + 1) * sizeof(int));
+
+    for (int p = 0; p < n; p++) level[p] = -1;
+
+    int next = 0;
+
+    // number every connected component separately
+    for (int root = 0; root < n; root++) {
+        if (level[root] != -1) continue;
+
+        // find a pseudo-peripheral pair of places (start, end)
+        int start = root;
+        int end = bfs_far(graph, start, dist, queue, level);
+        int ecc = dist[end];
+
+        for (;;) {
+            int candidate = bfs_far(graph, end, dist, queue, level);
+            if (dist[candidate] <= ecc) break;
+            start = end;
+            end = candidate;
+            ecc = dist[candidate];
+        }
+
+        bfs_far(graph, end, dist, queue, level);
+
+        int num_candidates = 0;
+
+        for (int p = 0; p < n; p++) {
+            if (dist[p] == -1) continue;
+
+            status[p] = INACTIVE;
+            priority[p] = (long) W1 * dist[p] - (long) W2 * (graph->adj_start[p + 1] - graph->adj_start[p] + 1);
+        }
+
+        status[start] = PREACTIVE;
+        candidates[num_candidates++] = start;
+
+        while (num_candidates > 0) {
+            // select the candidate with the highest priority
+            int best = 0;
+            for (int i = 1; i < num_candidates; i++) {
+                if (priority[candidates[i]] > priority[candidates[best]]) best = i;
+            }
+
+            int p = candidates[best];
+            candidates[best] = candidates[--num_candidates];
+
+            if (status[p] == PREACTIVE) {
+                for (int i = graph->adj_start[p]; i < graph->adj_start[p + 1]; i++) {
+                    int q = graph->adjacent[i];
+                    priority[q] += W2;
+
+                    if (status[q] == INACTIVE) {
+                        status[q] = PREACTIVE;
+                        candidates[num_candidates++] = q;
+                    }
+                }
+            }
+
+            status[p] = POSTACTIVE;
+            level[p] = next++;
+
+            for (int i = graph->adj_start[p]; i < graph->adj_start[p + 1]; i++) {
+                int q = graph->adjacent[i];
+                if (status[q] != PREACTIVE) continue;
+
+                status[q] = ACTIVE;
+                priority[q] += W2;
+
+                for (int j = graph->adj_start[q]; j < graph->adj_start[q + 1]; j++) {
+                    int r = graph->adjacent[j];
+                    if (status[r] == POSTACTIVE) continue;
+
+                    priority[r] += W2;
+
+                    if (status[r] == INACTIVE) {
+                        status[r] = PREACTIVE;
+                        candidates[num_candidates++] = r;
+                    }
+                }
+            }
+        }
+    }
+
+    free(dist);
+    free(queue);
+    free(status);
+    free(priority);
+    free(candidates);
+}
+
+/*
+ * Depth-first search over the place-transition graph, starting from the places in input order.
+ * Places are numbered in the order they are discovered.
+ */
+static void order_dfs(order_graph_t *graph, int *level) {
+    int n = graph->num_places;
+
+    // the stack holds places, and for every place the index of its next transition to visit
+    int *stack = mmalloc((n + 1) * sizeof(int));
+    int *next_trans = mmalloc((n + 1) * sizeof(int));
+    char *visited_trans = calloc(graph->num_transitions + 1, 1);
+
+    for (int p = 0; p < n; p++) level[p] = -1;
+
+    int next = 0;
+
+    for (int root = 0; root < n; root++) {
+        if (level[root] != -1) continue;
+
+        int top = 0;
+        stack[top++] = root;
+        next_trans[root] = graph->place_start[root];
+        level[root] = next++;
+
+        while (top > 0) {
+            int p = stack[top - 1];
+
+            if (next_trans[p] == graph->place_start[p + 1]) {
+                top--;
+                continue;
+            }
+
+            int t = graph->trans_of[next_trans[p]++];
+            if (visited_trans[t]) continue;
+            visited_trans[t] = 1;
+
+            // number all places of the transition, then descend into them
+            for (int i = graph->trans_start[t + 1] - 1; i >= graph->trans_start[t]; i--) {
+                int q = graph->place_of[i];
+                if (level[q] != -1) continue;
+
+                level[q] = -2;
+                next_trans[q] = graph->place_start[q];
+                stack[top++] = q;
+            }
+
+            for (int i = graph->trans_start[t]; i < graph->trans_start[t + 1]; i++) {
+                int q = graph->place_of[i];
+                if (level[q] == -2) level[q] = next++;
+            }
+        }
+    }
+
+    free(stack);
+    free(next_trans);
+    free(visited_trans);
+}
+
+static const char *heuristic_names[] = { "input", "force", "sloan", "dfs", "best" };
+
+int parse_order_heuristic(const char *name, order_heuristic_t *heuristic) {
+    for (int i = ORDER_INPUT; i <= ORDER_BEST; i++) {
+        if (strcmp(name, heuristic_names[i]) == 0) {
+            *heuristic = i;
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void compute_order(order_graph_t *graph, order_heuristic_t heuristic, int *level) {
+    switch (heuristic) {
+        case ORDER_FORCE:
+            for (int p = 0; p < graph->num_places; p++) level[p] = p;
+            order_force(graph, level);
+            break;
+        case ORDER_SLOAN:
+            order_sloan(graph, level);
+            break;
+        case ORDER_DFS:
+            order_dfs(graph, level);
+            break;
+        case ORDER_INPUT:
+        default:
+            for (int p = 0; p < graph->num_places; p++) level[p] = p;
+            break;
+    }
+}
+
+void order_places(andl_context_t *andl_context, order_heuristic_t heuristic) {
+    order_graph_t graph;
+    build_graph(andl_context, &graph);
+
+    int n = andl_context->num_places;
+    int *level = mmalloc((n + 1) * sizeof(int));
+
+    if (heuristic == ORDER_BEST) {
+        int *candidate = mmalloc((n + 1) * sizeof(int));
+        long best = -1;
+
+        for (int h = ORDER_INPUT; h < ORDER_BEST; h++) {
+            compute_order(&graph, h, candidate);
+
+            long s = span(&graph, candidate);
+            warn("Variable order %s has total span %ld", heuristic_names[h], s);
+
+            if (best == -1 || s < best) {
+                best = s;
+                heuristic = h;
+                memcpy(level, candidate, n * sizeof(int));
+            }
+        }
+
+        free(candidate);
+    } else {
+        compute_order(&graph, heuristic, level);
+    }
+
+    for (int p = 0; p < n; p++) andl_context->places[p].level = level[p];
+
+    warn("Using variable order %s, total span %ld", heuristic_names[heuristic], span(&graph, level));
+
+    free(level);
+    free_graph(&graph);
+}
+
+long order_span(andl_context_t *andl_context) {
+    order_graph_t graph;
+    build_graph(andl_context, &graph);
+
+    int *level = mmalloc((andl_context->num_places + 1) * sizeof(int));
+    for (int p = 0; p < andl_context->num_places; p++) level[p] = andl_context->places[p].level;
+
+    long s = span(&graph, level);
+
+    free(level);
+    free_graph(&graph);
+
+    return s;
+}
+
+int save_order(andl_context_t *andl_context, const char *name) {
+    FILE *f = fopen(name, "w");
+    if (f == NULL) {
+        warn("Could not open file '%s'", name);
+        return 1;
+    }
+
+    int n = andl_context->num_places;
+    place_t **by_level = mmalloc((n + 1) * sizeof(place_t *));
+
+    for (int p = 0; p < n; p++) by_level[andl_context->places[p].level] = andl_context->places + p;
+    for (int l = 0; l < n; l++) fprintf(f, "%s\n", by_level[l]->name);
+
+    free(by_level);
+    fclose(f);
+
+    return 0;
+}
+
+int load_order(andl_context_t *andl_context, const char *name) {
+    FILE *f = fopen(name, "r");
+    if (f == NULL) {
+        warn("Could not open file '%s'", name);
+        return 1;
+    }
+
+    int n = andl_context->num_places;
+    for (int p = 0; p < n; p++) andl_context->places[p].level = -1;
+
+    int next = 0;
+    int res = 0;
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t len;
+
+    while ((len = getline(&line, &size, f)) != -1) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        if (len == 0) continue;
+
+        int found = 0;
+        for (int p = 0; p < n && !found; p++) {
+            place_t *place = andl_context->places + p;
+
+            if (strcmp(place->name, line) == 0) {
+                found = 1;
+
+                if (place->level == -1) {
+                    place->level = next++;
+                } else {
+                    warn("Place '%s' occurs twice in '%s'", line, name);
+                    res = 1;
+                }
+            }
+        }
+
+        if (!found) {
+            warn("Unknown place '%s' in '%s'", line, name);
+            res = 1;
+        }
+    }
+
+    for (int p = 0; p < n; p++) {
+        if (andl_context->places[p].level == -1) andl_context->places[p].level = next++;
+    }
+
+    free(line);
+    fclose(f);
+
+    return res;
+}
@@ -0,0 +1,52 @@
+#include "andl.h"
+
+#ifndef ORDER_H
+#define ORDER_H
+
+/**
+ * \brief The heuristics available to order the place variables:
+ *  - ORDER_INPUT keeps the order of the places in the andl file,
+ *  - ORDER_FORCE moves places towards the centre of gravity of their transitions,
+ *  - ORDER_SLOAN reduces the profile of the place adjacency graph with Sloan's algorithm,
+ *  - ORDER_DFS numbers the places in depth-first order over the place-transition graph,
+ *  - ORDER_BEST tries all of the above and keeps the one with the smallest total span.
+ */
+typedef enum {
+    ORDER_INPUT,
+    ORDER_FORCE,
+    ORDER_SLOAN,
+    ORDER_DFS,
+    ORDER_BEST,
+} order_heuristic_t;
+
+/**
+ * Parses the name of an ordering heuristic as given on the command line.
+ * \return: 0 on success, 1 if the name is unknown.
+ */
+int parse_order_heuristic(const char *name, order_heuristic_t *heuristic);
+
+/**
+ * Assigns a level to every place in \p andl_context with the given \p heuristic.
+ */
+void order_places(andl_context_t *andl_context, order_heuristic_t heuristic);
+
+/**
+ * The total span of the current order: the sum over all transitions of the distance between the
+ * top-most and bottom-most place they touch. Smaller spans generally give smaller BDDs.
+ */
+long order_span(andl_context_t *andl_context);
+
+/**
+ * Writes the current order to \p name, one place name per line, top-most place first.
+ * \return: 0 on success, 1 on failure.
+ */
+int save_order(andl_context_t *andl_context, const char *name);
+
+/**
+ * Reads an order written by save_order from \p name. Places missing from the file are put below
+ * the listed places, in input order.
+ * \return: 0 on success, 1 on failure.
+ */
+int load_order(andl_context_t *andl_context, const char *name);
+
+#endif
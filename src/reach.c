@@ -0,0 +1,497 @@
+#include "reach.h"
+
+#include <string.h>
+
+#include <sylvan.h>
+
+#include "reorder.h"
+#include "util.h"
+
+/*
+ * The number of nodes currently in Sylvan's node table, including nodes that are not yet garbage
+ * collected. Peak counts are sampled with this, at the end of every iteration.
+ */
+static size_t table_filled() {
+    size_t filled, total;
+    sylvan_table_usage(&filled, &total);
+    return filled;
+}
+
+int parse_reach_strategy(const char *name, reach_strategy_t *strategy) {
+    if (strcmp(name, "bfs") == 0) {
+        *strategy = REACH_BFS;
+    } else if (strcmp(name, "frontier") == 0) {
+        *strategy = REACH_FRONTIER;
+    } else if (strcmp(name, "chain") == 0) {
+        *strategy = REACH_CHAINING;
+    } else if (strcmp(name, "sat") == 0) {
+        *strategy = REACH_SATURATION;
+    } else {
+        return 1;
+    }
+
+    return 0;
+}
+
+BDD reach(reach_strategy_t strategy, BDD init, relation_t *relations, int num_relations, int num_levels) {
+    switch (strategy) {
+        case REACH_FRONTIER:
+            return reach_frontier(init, relations, num_relations, num_levels);
+        case REACH_CHAINING:
+            return reach_chaining(init, relations, num_relations, num_levels);
+        case REACH_SATURATION:
+            return reach_saturation(init, relations, num_relations, num_levels);
+        case REACH_BFS:
+        default:
+            return reach_bfs(init, relations, num_relations, num_levels);
+    }
+}
+
+/*
+ * Compute the successors of the given states under the relations from up to (but excluding) to.
+ * The halves are computed as parallel tasks and joined with a single union, so the unions form a
+ * balanced tree instead of a chain.
+ */
+TASK_4(BDD, image_tree, BDD, states, relation_t *, relations, int, from, int, to)
+{
+    if (to - from == 0) return sylvan_false;
+    if (to - from == 1) return image(states, relations + from);
+
+    int mid = from + (to - from) / 2;
+
+    mtbdd_refs_spawn(SPAWN(image_tree, states, relations, from, mid));
+    BDD right = CALL(image_tree, states, relations, mid, to);
+    mtbdd_refs_push(right);
+    BDD left = mtbdd_refs_sync(SYNC(image_tree));
+    mtbdd_refs_push(left);
+
+    BDD result = sylvan_or(left, right);
+    mtbdd_refs_pop(2);
+
+    return result;
+}
+
+/*
+ * Breadth-first search: apply every transition to the whole set of states found so far, until no
+ * new states are found.
+ */
+BDD reach_bfs(BDD init, relation_t *relations, int num_relations, int num_levels) {
+    LACE_ME;
+
+    BDD vOld = sylvan_set_empty();
+    BDD vNew = init;
+    reorder_protect(&vOld);
+    reorder_protect(&vNew);
+
+    int bfs_counter = 0;
+    size_t peak = table_filled();
+    double start = wctime();
+
+    while (vOld != vNew) {
+        vOld = vNew;
+
+        double t = wctime();
+
+        vNew = sylvan_or(vNew, CALL(image_tree, vNew, relations, 0, num_relations));
+
+        bfs_counter++;
+
+        // counting the table scans it entirely, so only sample it once per iteration
+        size_t filled = table_filled();
+        if (filled > peak) peak = filled;
+
+        warn("BFS iteration %d: %.3f s, %.0f new states, %zu nodes in the set, %zu nodes in the table",
+                bfs_counter, wctime() - t, mtbdd_satcount(sylvan_and(vNew, sylvan_not(vOld)), num_levels),
+                sylvan_nodecount(vNew), filled);
+
+        reorder_maybe();
+    }
+
+    printf("Number of loops: %d\n", bfs_counter);
+    printf("BFS time: %.3f s\n", wctime() - start);
+    printf("Peak node count: %zu\n", peak);
+
+    reorder_unprotect(&vOld);
+    reorder_unprotect(&vNew);
+
+    return vNew;
+}
+
+/*
+ * Frontier search: only the states found in the previous iteration are given to the transitions.
+ */
+BDD reach_frontier(BDD init, relation_t *relations, int num_relations, int num_levels) {
+    LACE_ME;
+
+    BDD visited = init;
+    BDD frontier = init;
+    BDD next = sylvan_false;
+    reorder_protect(&visited);
+    reorder_protect(&frontier);
+    reorder_protect(&next);
+
+    int counter = 0;
+    double start = wctime();
+
+    while (frontier != sylvan_false) {
+        double t = wctime();
+
+        next = CALL(image_tree, frontier, relations, 0, num_relations);
+
+        frontier = sylvan_and(next, sylvan_not(visited));
+        visited = sylvan_or(visited, frontier);
+
+        counter++;
+
+        warn("Frontier iteration %d: %.3f s, %.0f new states, %zu nodes in the frontier",
+                counter, wctime() - t, mtbdd_satcount(frontier, num_levels), sylvan_nodecount(frontier));
+
+        reorder_maybe();
+    }
+
+    printf("Number of loops: %d\n", counter);
+    printf("Frontier time: %.3f s\n", wctime() - start);
+
+    reorder_unprotect(&visited);
+    reorder_unprotect(&frontier);
+    reorder_unprotect(&next);
+
+    return visited;
+}
+
+/*
+ * Chaining: like the frontier search, but the states found by a transition are immediately given
+ * to the transitions after it in the same iteration.
+ */
+BDD reach_chaining(BDD init, relation_t *relations, int num_relations, int num_levels) {
+    LACE_ME;
+
+    BDD visited = init;
+    BDD frontier = init;
+    BDD chain = sylvan_false;
+    reorder_protect(&visited);
+    reorder_protect(&frontier);
+    reorder_protect(&chain);
+
+    int counter = 0;
+    double start = wctime();
+
+    while (frontier != sylvan_false) {
+        double t = wctime();
+
+        chain = frontier;
+
+        for (int i = 0; i < num_relations; i++) {
+            chain = sylvan_or(chain, sylvan_and(image(chain, relations + i), sylvan_not(visited)));
+        }
+
+        frontier = sylvan_and(chain, sylvan_not(visited));
+        visited = sylvan_or(visited, frontier);
+
+        counter++;
+
+        warn("Chaining iteration %d: %.3f s, %.0f new states, %zu nodes in the frontier",
+                counter, wctime() - t, mtbdd_satcount(frontier, num_levels), sylvan_nodecount(frontier));
+
+        reorder_maybe();
+    }
+
+    printf("Number of loops: %d\n", counter);
+    printf("Chaining time: %.3f s\n", wctime() - start);
+
+    reorder_unprotect(&visited);
+    reorder_unprotect(&frontier);
+    reorder_unprotect(&chain);
+
+    return visited;
+}
+
+/*
+ * Saturation works on the levels of the BDD, one level per place. A set is saturated at level k
+ * when it is closed under all transitions whose top-most place is at level k or below. Saturating
+ * a node at level k first saturates both its children at level k+1, and then fires the transitions
+ * of level k until a fixpoint is reached, saturating every newly found set of states below level k
+ * as it is found. Saturated nodes are memoized, since the same node is reached along many paths.
+ *
+ * The same procedure runs backward by firing the transitions with the pre-image. It can also be
+ * constrained: only states in the constraint are added, which gives the least fixpoint of E[a U b]
+ * when saturating b backward under the constraint a. The constraint is cofactored along with the
+ * set, so it is part of the key of a saturated node.
+ */
+
+typedef struct {
+    BDD set;
+    BDD constraint;
+    BDD result;
+    int level;
+} sat_entry_t;
+
+typedef struct {
+    // the relations sorted by their top level
+    relation_t *relations;
+    int num_relations;
+
+    // the relations of level k are relations[first[k]] up to relations[first[k + 1]]
+    int *first;
+    int num_levels;
+
+    // the deepest level that still has transitions
+    int max_top;
+
+    // fire the transitions backward, with the pre-image
+    int backward;
+
+    // open addressing hash table of saturated nodes
+    sat_entry_t *memo;
+    size_t memo_size;
+    size_t memo_count;
+} sat_context_t;
+
+static size_t sat_hash(BDD set, BDD constraint, int level, size_t size) {
+    uint64_t h = set * 0x9E3779B97F4A7C15ULL + constraint * 0xC2B2AE3D27D4EB4FULL + (uint64_t) level;
+    h ^= h >> 29;
+    return (size_t) (h & (size - 1));
+}
+
+static sat_entry_t *sat_find(sat_context_t *ctx, BDD set, BDD constraint, int level) {
+    size_t i = sat_hash(set, constraint, level, ctx->memo_size);
+
+    while (ctx->memo[i].set != sylvan_invalid) {
+        if (ctx->memo[i].set == set && ctx->memo[i].constraint == constraint && ctx->memo[i].level == level) {
+            break;
+        }
+
+        i = (i + 1) & (ctx->memo_size - 1);
+    }
+
+    return ctx->memo + i;
+}
+
+static void sat_memo_init(sat_context_t *ctx, size_t size) {
+    ctx->memo_size = size;
+    ctx->memo_count = 0;
+    ctx->memo = mmalloc(size * sizeof(sat_entry_t));
+
+    for (size_t i = 0; i < size; i++) {
+        ctx->memo[i].set = sylvan_invalid;
+    }
+}
+
+static void sat_memo_put(sat_context_t *ctx, BDD set, BDD constraint, int level, BDD result) {
+    if (2 * (ctx->memo_count + 1) > ctx->memo_size) {
+        // grow the table, the entries keep their references
+        sat_entry_t *old = ctx->memo;
+        size_t old_size = ctx->memo_size;
+
+        sat_memo_init(ctx, old_size * 2);
+
+        for (size_t i = 0; i < old_size; i++) {
+            if (old[i].set != sylvan_invalid) {
+                *sat_find(ctx, old[i].set, old[i].constraint, old[i].level) = old[i];
+                ctx->memo_count++;
+            }
+        }
+
+        free(old);
+    }
+
+    sat_entry_t *entry = sat_find(ctx, set, constraint, level);
+
+    // the keys are referenced as well, so their nodes cannot be reused for other sets
+    entry->set = sylvan_ref(set);
+    entry->constraint = sylvan_ref(constraint);
+    entry->result = sylvan_ref(result);
+    entry->level = level;
+    ctx->memo_count++;
+}
+
+static void sat_memo_free(sat_context_t *ctx) {
+    for (size_t i = 0; i < ctx->memo_size; i++) {
+        if (ctx->memo[i].set != sylvan_invalid) {
+            sylvan_deref(ctx->memo[i].set);
+            sylvan_deref(ctx->memo[i].constraint);
+            sylvan_deref(ctx->memo[i].result);
+        }
+    }
+
+    free(ctx->memo);
+}
+
+static int compare_top(const void *a, const void *b) {
+    return ((const relation_t *) a)->top - ((const relation_t *) b)->top;
+}
+
+/*
+ * Group the relations by their top level. Transitions without arcs do not change the state, and
+ * are left out. The relations themselves are not modified, so they can be shared between
+ * saturations that run in parallel.
+ */
+static void sat_init(sat_context_t *ctx, relation_t *relations, int num_relations, int num_levels, int backward) {
+    ctx->num_levels = num_levels;
+    ctx->max_top = -1;
+    ctx->backward = backward;
+
+    ctx->relations = mmalloc((num_relations + 1) * sizeof(relation_t));
+    int num_sorted = 0;
+
+    for (int i = 0; i < num_relations; i++) {
+        // dynamic reordering may have moved the places since the relations were built
+        BDD variables = relations[i].variables;
+        if (sylvan_set_isempty(variables)) continue;
+
+        ctx->relations[num_sorted] = relations[i];
+        ctx->relations[num_sorted].top = (int) sylvan_set_first(variables) / 2;
+        num_sorted++;
+    }
+
+    qsort(ctx->relations, num_sorted, sizeof(relation_t), compare_top);
+    ctx->num_relations = num_sorted;
+
+    ctx->first = mmalloc((num_levels + 1) * sizeof(int));
+
+    for (int level = 0, i = 0; level <= num_levels; level++) {
+        ctx->first[level] = i;
+
+        while (i < num_sorted && ctx->relations[i].top == level) i++;
+    }
+
+    if (num_sorted > 0) ctx->max_top = ctx->relations[num_sorted - 1].top;
+
+    sat_memo_init(ctx, 1024);
+}
+
+static void sat_free(sat_context_t *ctx) {
+    sat_memo_free(ctx);
+    free(ctx->first);
+    free(ctx->relations);
+}
+
+TASK_DECL_4(BDD, saturate, sat_context_t *, BDD, BDD, int);
+
+/*
+ * Saturate both cofactors of the given set at the next level.
+ */
+TASK_4(BDD, saturate_below, sat_context_t *, ctx, BDD, set, BDD, constraint, int, level)
+{
+    if (set == sylvan_false || level > ctx->max_top) return set;
+
+    BDDVAR var = 2 * level;
+
+    BDD low = set;
+    BDD high = set;
+    sylvan_protect(&low);
+    sylvan_protect(&high);
+
+    BDD constraint_low = constraint;
+    BDD constraint_high = constraint;
+
+    if (!sylvan_isconst(set) && sylvan_var(set) == var) {
+        low = sylvan_low(set);
+        high = sylvan_high(set);
+    }
+
+    if (!sylvan_isconst(constraint) && sylvan_var(constraint) == var) {
+        constraint_low = sylvan_low(constraint);
+        constraint_high = sylvan_high(constraint);
+    }
+
+    low = CALL(saturate, ctx, low, constraint_low, level + 1);
+    high = CALL(saturate, ctx, high, constraint_high, level + 1);
+
+    BDD result = sylvan_ite(sylvan_ithvar(var), high, low);
+
+    sylvan_unprotect(&low);
+    sylvan_unprotect(&high);
+
+    return result;
+}
+
+TASK_IMPL_4(BDD, saturate, sat_context_t *, ctx, BDD, set, BDD, constraint, int, level)
+{
+    if (set == sylvan_false || level > ctx->max_top) return set;
+
+    sat_entry_t *entry = sat_find(ctx, set, constraint, level);
+    if (entry->set != sylvan_invalid) return entry->result;
+
+    BDD result = CALL(saturate_below, ctx, set, constraint, level);
+    BDD old = sylvan_false;
+    BDD next = sylvan_false;
+    sylvan_protect(&result);
+    sylvan_protect(&old);
+    sylvan_protect(&next);
+
+    // fire the transitions of this level until a fixpoint is reached
+    while (result != old) {
+        old = result;
+
+        for (int i = ctx->first[level]; i < ctx->first[level + 1]; i++) {
+            if (ctx->backward) {
+                next = preimage(result, ctx->relations + i);
+            } else {
+                next = image(result, ctx->relations + i);
+            }
+
+            if (constraint != sylvan_true) next = sylvan_and(next, constraint);
+
+            next = CALL(saturate_below, ctx, next, constraint, level);
+
+            result = sylvan_or(result, next);
+        }
+    }
+
+    sat_memo_put(ctx, set, constraint, level, result);
+
+    sylvan_unprotect(&result);
+    sylvan_unprotect(&old);
+    sylvan_unprotect(&next);
+
+    return result;
+}
+
+BDD reach_saturation(BDD init, relation_t *relations, int num_relations, int num_levels) {
+    LACE_ME;
+
+    sat_context_t ctx;
+    sat_init(&ctx, relations, num_relations, num_levels, 0);
+
+    int groups = 0;
+    for (int level = 0; level < num_levels; level++) {
+        if (ctx.first[level + 1] > ctx.first[level]) groups++;
+    }
+
+    warn("Saturation: %d transitions in %d levels", ctx.num_relations, groups);
+
+    double start = wctime();
+
+    BDD result = CALL(saturate, &ctx, init, sylvan_true, 0);
+    sylvan_protect(&result);
+
+    printf("Saturated nodes: %zu\n", ctx.memo_count);
+    printf("Saturation time: %.3f s\n", wctime() - start);
+    printf("Node count: %zu in the set, %zu in the table\n", sylvan_nodecount(result), table_filled());
+
+    sat_free(&ctx);
+
+    sylvan_unprotect(&result);
+
+    return result;
+}
+
+/*
+ * Backward saturation from \p states, only adding states in \p constraint.
+ */
+BDD saturate_backward(BDD states, BDD constraint, relation_t *relations, int num_relations, int num_levels) {
+    LACE_ME;
+
+    sat_context_t ctx;
+    sat_init(&ctx, relations, num_relations, num_levels, 1);
+
+    BDD result = CALL(saturate, &ctx, states, constraint, 0);
+    sylvan_protect(&result);
+
+    sat_free(&ctx);
+
+    sylvan_unprotect(&result);
+
+    return result;
+}
@@ -0,0 +1,51 @@
+#include <sylvan.h>
+#include "state_space.h"
+
+#ifndef REACH_H
+#define REACH_H
+
+/**
+ * \brief The algorithms available to compute the set of reachable markings.
+ *  - REACH_BFS applies every transition to the whole set until nothing changes,
+ *  - REACH_FRONTIER only applies the transitions to the states found in the previous iteration,
+ *  - REACH_CHAINING is like REACH_FRONTIER, but feeds the output of every transition to the
+ *    next transition within the same iteration,
+ *  - REACH_SATURATION saturates the BDD bottom-up, level by level.
+ */
+typedef enum {
+    REACH_BFS,
+    REACH_FRONTIER,
+    REACH_CHAINING,
+    REACH_SATURATION,
+} reach_strategy_t;
+
+/**
+ * Parses the name of a reachability strategy as given on the command line.
+ * \return: 0 on success, 1 if the name is unknown.
+ */
+int parse_reach_strategy(const char *name, reach_strategy_t *strategy);
+
+/**
+ * Computes all states reachable from \p init with the chosen \p strategy.
+ * \p relations: the relations of all \p num_relations transitions.
+ * \p num_levels: the number of place levels in the encoding.
+ */
+BDD reach(reach_strategy_t strategy, BDD init, relation_t *relations, int num_relations, int num_levels);
+
+BDD reach_bfs(BDD init, relation_t *relations, int num_relations, int num_levels);
+
+BDD reach_frontier(BDD init, relation_t *relations, int num_relations, int num_levels);
+
+BDD reach_chaining(BDD init, relation_t *relations, int num_relations, int num_levels);
+
+BDD reach_saturation(BDD init, relation_t *relations, int num_relations, int num_levels);
+
+/**
+ * Computes all states that can reach \p states by saturation with the pre-image, while only
+ * passing through states in \p constraint; the result is E[constraint U states].
+ * \p relations: the relations of all \p num_relations transitions.
+ * \p num_levels: the number of place levels in the encoding.
+ */
+BDD saturate_backward(BDD states, BDD constraint, relation_t *relations, int num_relations, int num_levels);
+
+#endif
@@ -0,0 +1,546 @@
+#include "reduce.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+/*
+ * The rules work on the arcs of the transitions in place. Removed places and transitions are only
+ * marked, and arcs to removed places are ignored, until the net is compacted at the end. The
+ * arcs of every place are collected again before every round.
+ */
+
+typedef enum {
+    RULE_REDUNDANT,
+    RULE_IMPLICIT,
+    RULE_SEQUENTIAL,
+    RULE_POST_AGGLOMERATION,
+    RULE_PRE_AGGLOMERATION,
+    NUM_RULES,
+} reduce_rule_t;
+
+static const char *rule_names[] = {
+    "redundant places",
+    "implicit places",
+    "sequential fusion",
+    "post-agglomeration",
+    "pre-agglomeration",
+};
+
+typedef struct {
+    andl_context_t *net;
+    const char *queried;
+
+    char *place_removed;
+    char *transition_removed;
+
+    // the transitions whose arcs changed in the current round
+    char *touched;
+
+    // the places that gained arcs in the current round, their arcs below are out of date
+    char *dirty;
+
+    // the places that are an input of a queried transition
+    char *read_by_query;
+
+    // the arcs of place p are arc_of[start[p]] up to arc_of[start[p + 1]], as 2 * transition + dir
+    int *start;
+    int *arc_of;
+
+    int *producers;
+    int *consumers;
+
+    int places_removed[NUM_RULES];
+    int transitions_removed[NUM_RULES];
+} reducer_t;
+
+static int place_index(reducer_t *r, place_t *place) {
+    return (int) (place - r->net->places);
+}
+
+static int is_kept(reducer_t *r, arc_t *arc) {
+    return !r->place_removed[place_index(r, arc->place)];
+}
+
+static void collect_arcs(reducer_t *r) {
+    andl_context_t *net = r->net;
+    int n = net->num_places;
+
+    memset(r->start, 0, (n + 1) * sizeof(int));
+    memset(r->producers, 0, n * sizeof(int));
+    memset(r->consumers, 0, n * sizeof(int));
+
+    for (int t = 0; t < net->num_transitions; t++) {
+        if (r->transition_removed[t]) continue;
+
+        transition_t *transition = net->transitions + t;
+
+        for (int i = 0; i < transition->num_arcs; i++) {
+            arc_t *arc = transition->arcs + i;
+            if (!is_kept(r, arc)) continue;
+
+            int p = place_index(r, arc->place);
+            r->start[p + 1]++;
+
+            if (arc->dir == ARC_IN) {
+                r->consumers[p]++;
+            } else {
+                r->producers[p]++;
+            }
+        }
+    }
+
+    for (int p = 0; p < n; p++) r->start[p + 1] += r->start[p];
+
+    free(r->arc_of);
+    r->arc_of = mmalloc((r->start[n] + 1) * sizeof(int));
+
+    int *fill = mmalloc((n + 1) * sizeof(int));
+    memcpy(fill, r->start, n * sizeof(int));
+
+    for (int t = 0; t < net->num_transitions; t++) {
+        if (r->transition_removed[t]) continue;
+
+        transition_t *transition = net->transitions + t;
+
+        for (int i = 0; i < transition->num_arcs; i++) {
+            arc_t *arc = transition->arcs + i;
+            if (!is_kept(r, arc)) continue;
+
+            r->arc_of[fill[place_index(r, arc->place)]++] = 2 * t + arc->dir;
+        }
+    }
+
+    free(fill);
+}
+
+static int has_arc(reducer_t *r, transition_t *transition, int place, arc_dir_t dir) {
+    for (int i = 0; i < transition->num_arcs; i++) {
+        arc_t *arc = transition->arcs + i;
+
+        if (arc->dir == dir && place_index(r, arc->place) == place) return 1;
+    }
+
+    return 0;
+}
+
+static int count_arcs(reducer_t *r, transition_t *transition, arc_dir_t dir) {
+    int count = 0;
+
+    for (int i = 0; i < transition->num_arcs; i++) {
+        if (transition->arcs[i].dir == dir && is_kept(r, transition->arcs + i)) count++;
+    }
+
+    return count;
+}
+
+static void add_arc(reducer_t *r, transition_t *transition, place_t *place, arc_dir_t dir) {
+    if (has_arc(r, transition, place_index(r, place), dir)) return;
+
+    r->dirty[place_index(r, place)] = 1;
+
+    if (transition->num_arcs >= transition->arcs_buf_size - 1) {
+        transition->arcs_buf_size *= 2;
+        transition->arcs = rrealloc(transition->arcs, transition->arcs_buf_size * sizeof(arc_t));
+    }
+
+    transition->arcs[transition->num_arcs].place = place;
+    transition->arcs[transition->num_arcs].dir = dir;
+    transition->arcs[transition->num_arcs].weight = 1;
+    transition->num_arcs++;
+}
+
+static void remove_arc(reducer_t *r, transition_t *transition, int place, arc_dir_t dir) {
+    int n = 0;
+
+    for (int i = 0; i < transition->num_arcs; i++) {
+        arc_t *arc = transition->arcs + i;
+
+        if (arc->dir != dir || place_index(r, arc->place) != place) transition->arcs[n++] = *arc;
+    }
+
+    transition->num_arcs = n;
+}
+
+// whether the kept places of \p transition in direction \p dir are not a \p other_dir place of \p other
+static int disjoint(reducer_t *r, transition_t *transition, arc_dir_t dir, transition_t *other, arc_dir_t other_dir) {
+    for (int i = 0; i < transition->num_arcs; i++) {
+        arc_t *arc = transition->arcs + i;
+
+        if (arc->dir == dir && is_kept(r, arc) && has_arc(r, other, place_index(r, arc->place), other_dir)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void remove_place(reducer_t *r, int place, reduce_rule_t rule) {
+    r->place_removed[place] = 1;
+    r->places_removed[rule]++;
+}
+
+static void remove_transition(reducer_t *r, int transition, reduce_rule_t rule) {
+    r->transition_removed[transition] = 1;
+    r->touched[transition] = 1;
+    r->transitions_removed[rule]++;
+}
+
+/*
+ * A place that no transition consumes from never disables a transition.
+ */
+static int remove_redundant(reducer_t *r) {
+    int removed = 0;
+
+    for (int p = 0; p < r->net->num_places; p++) {
+        if (!r->place_removed[p] && r->consumers[p] == 0) {
+            remove_place(r, p, RULE_REDUNDANT);
+            removed = 1;
+        }
+    }
+
+    return removed;
+}
+
+static uint64_t place_hash(reducer_t *r, int p) {
+    uint64_t h = (uint64_t) r->net->places[p].initial_marking;
+
+    for (int i = r->start[p]; i < r->start[p + 1]; i++) {
+        h = h * 0x100000001B3ULL + (uint64_t) r->arc_of[i] + 1;
+    }
+
+    return h ^ (h >> 31);
+}
+
+static uint64_t *hashes;
+
+static int compare_hash(const void *a, const void *b) {
+    uint64_t x = hashes[*(const int *) a];
+    uint64_t y = hashes[*(const int *) b];
+
+    return x < y ? -1 : x > y ? 1 : *(const int *) a - *(const int *) b;
+}
+
+static int same_place(reducer_t *r, int p, int q) {
+    if (r->net->places[p].initial_marking != r->net->places[q].initial_marking) return 0;
+    if (r->start[p + 1] - r->start[p] != r->start[q + 1] - r->start[q]) return 0;
+
+    return memcmp(r->arc_of + r->start[p], r->arc_of + r->start[q], (r->start[p + 1] - r->start[p]) * sizeof(int)) == 0;
+}
+
+/*
+ * A place with the same initial marking and the same arcs as another place always has the same
+ * marking, so the other place already disables every transition it disables.
+ */
+static int remove_implicit(reducer_t *r) {
+    int n = r->net->num_places;
+    int *sorted = mmalloc((n + 1) * sizeof(int));
+    int num_sorted = 0;
+
+    hashes = mmalloc((n + 1) * sizeof(uint64_t));
+
+    for (int p = 0; p < n; p++) {
+        if (r->place_removed[p]) continue;
+
+        hashes[p] = place_hash(r, p);
+        sorted[num_sorted++] = p;
+    }
+
+    qsort(sorted, num_sorted, sizeof(int), compare_hash);
+
+    int removed = 0;
+
+    for (int i = 0, first = 0; i < num_sorted; i++) {
+        if (hashes[sorted[i]] != hashes[sorted[first]]) first = i;
+
+        if (i != first && same_place(r, sorted[first], sorted[i])) {
+            remove_place(r, sorted[i], RULE_IMPLICIT);
+            removed = 1;
+        }
+    }
+
+    free(hashes);
+    free(sorted);
+
+    return removed;
+}
+
+/*
+ * Place p has a single consumer t, which only consumes from p. Once p is marked, t stays enabled
+ * until it fires, and firing t only changes p and places no queried transition reads. So t can
+ * fire directly after every producer of p, and p is no longer needed.
+ */
+static int post_agglomerate(reducer_t *r, int p) {
+    transition_t *transitions = r->net->transitions;
+    int t = -1;
+
+    for (int i = r->start[p]; i < r->start[p + 1]; i++) {
+        if (r->arc_of[i] % 2 == ARC_IN) t = r->arc_of[i] / 2;
+    }
+
+    transition_t *consumer = transitions + t;
+
+    if (r->queried[t] || r->touched[t] || count_arcs(r, consumer, ARC_IN) != 1) return 0;
+    if (r->producers[p] == 0 || has_arc(r, consumer, p, ARC_OUT)) return 0;
+
+    for (int i = 0; i < consumer->num_arcs; i++) {
+        arc_t *arc = consumer->arcs + i;
+
+        if (arc->dir == ARC_OUT && is_kept(r, arc) && r->read_by_query[place_index(r, arc->place)]) return 0;
+    }
+
+    for (int i = r->start[p]; i < r->start[p + 1]; i++) {
+        if (r->arc_of[i] % 2 != ARC_OUT) continue;
+
+        int u = r->arc_of[i] / 2;
+        transition_t *producer = transitions + u;
+
+        // a place in both the inputs and the outputs of the fused transition would disable it
+        if (r->touched[u] || has_arc(r, producer, p, ARC_IN) || !disjoint(r, consumer, ARC_OUT, producer, ARC_IN)) {
+            return 0;
+        }
+    }
+
+    for (int i = r->start[p]; i < r->start[p + 1]; i++) {
+        if (r->arc_of[i] % 2 != ARC_OUT) continue;
+
+        transition_t *producer = transitions + r->arc_of[i] / 2;
+        remove_arc(r, producer, p, ARC_OUT);
+
+        for (int j = 0; j < consumer->num_arcs; j++) {
+            arc_t *arc = consumer->arcs + j;
+            if (arc->dir == ARC_OUT && is_kept(r, arc)) add_arc(r, producer, arc->place, ARC_OUT);
+        }
+
+        r->touched[r->arc_of[i] / 2] = 1;
+    }
+
+    reduce_rule_t rule = r->producers[p] == 1 ? RULE_SEQUENTIAL : RULE_POST_AGGLOMERATION;
+    remove_transition(r, t, rule);
+    remove_place(r, p, rule);
+
+    return 1;
+}
+
+/*
+ * Place p has a single producer t, which only produces in p, and is the only consumer of its own
+ * input places. Firing t early does not enable or disable anything but the consumers of p, so t
+ * can fire as part of every consumer of p, and p is no longer needed.
+ */
+static int pre_agglomerate(reducer_t *r, int p) {
+    transition_t *transitions = r->net->transitions;
+    int t = -1;
+
+    for (int i = r->start[p]; i < r->start[p + 1]; i++) {
+        if (r->arc_of[i] % 2 == ARC_OUT) t = r->arc_of[i] / 2;
+    }
+
+    transition_t *producer = transitions + t;
+
+    if (r->queried[t] || r->touched[t] || count_arcs(r, producer, ARC_OUT) != 1) return 0;
+    if (count_arcs(r, producer, ARC_IN) == 0 || has_arc(r, producer, p, ARC_IN)) return 0;
+
+    for (int i = 0; i < producer->num_arcs; i++) {
+        arc_t *arc = producer->arcs + i;
+
+        if (arc->dir != ARC_IN || !is_kept(r, arc)) continue;
+
+        int q = place_index(r, arc->place);
+        if (r->dirty[q] || r->consumers[q] != 1) return 0;
+    }
+
+    for (int i = r->start[p]; i < r->start[p + 1]; i++) {
+        if (r->arc_of[i] % 2 != ARC_IN) continue;
+
+        int u = r->arc_of[i] / 2;
+        transition_t *consumer = transitions + u;
+
+        if (r->queried[u] || r->touched[u] || !disjoint(r, producer, ARC_IN, consumer, ARC_OUT)) return 0;
+    }
+
+    for (int i = r->start[p]; i < r->start[p + 1]; i++) {
+        if (r->arc_of[i] % 2 != ARC_IN) continue;
+
+        transition_t *consumer = transitions + r->arc_of[i] / 2;
+        remove_arc(r, consumer, p, ARC_IN);
+
+        for (int j = 0; j < producer->num_arcs; j++) {
+            arc_t *arc = producer->arcs + j;
+            if (arc->dir == ARC_IN && is_kept(r, arc)) add_arc(r, consumer, arc->place, ARC_IN);
+        }
+
+        r->touched[r->arc_of[i] / 2] = 1;
+    }
+
+    remove_transition(r, t, RULE_PRE_AGGLOMERATION);
+    remove_place(r, p, RULE_PRE_AGGLOMERATION);
+
+    return 1;
+}
+
+static int agglomerate(reducer_t *r) {
+    int removed = 0;
+
+    memset(r->touched, 0, r->net->num_transitions);
+    memset(r->dirty, 0, r->net->num_places);
+
+    for (int p = 0; p < r->net->num_places; p++) {
+        if (r->place_removed[p] || r->dirty[p] || r->net->places[p].initial_marking != 0) continue;
+
+        if (r->consumers[p] == 1 && post_agglomerate(r, p)) {
+            removed = 1;
+        } else if (r->producers[p] == 1 && r->consumers[p] > 0 && pre_agglomerate(r, p)) {
+            removed = 1;
+        }
+    }
+
+    return removed;
+}
+
+/*
+ * Remove the marked places and transitions, and renumber the ones that remain.
+ */
+static void compact(reducer_t *r) {
+    andl_context_t *net = r->net;
+
+    int *new_index = mmalloc((net->num_places + 1) * sizeof(int));
+    int num_places = 0;
+
+    for (int p = 0; p < net->num_places; p++) {
+        new_index[p] = r->place_removed[p] ? -1 : num_places++;
+    }
+
+    int num_transitions = 0;
+    net->num_in_arcs = 0;
+    net->num_out_arcs = 0;
+
+    for (int t = 0; t < net->num_transitions; t++) {
+        transition_t *transition = net->transitions + t;
+
+        if (r->transition_removed[t]) {
+            free(transition->name);
+            free(transition->arcs);
+            continue;
+        }
+
+        int n = 0;
+
+        for (int i = 0; i < transition->num_arcs; i++) {
+            arc_t arc = transition->arcs[i];
+            int p = new_index[place_index(r, arc.place)];
+            if (p == -1) continue;
+
+            arc.place = net->places + p;
+            transition->arcs[n++] = arc;
+
+            if (arc.dir == ARC_IN) {
+                net->num_in_arcs++;
+            } else {
+                net->num_out_arcs++;
+            }
+        }
+
+        transition->num_arcs = n;
+        transition->identifier = num_transitions;
+        net->transitions[num_transitions++] = *transition;
+    }
+
+    for (int p = 0; p < net->num_places; p++) {
+        if (new_index[p] == -1) {
+            free(net->places[p].name);
+            continue;
+        }
+
+        place_t *place = net->places + new_index[p];
+        *place = net->places[p];
+        place->identifier = new_index[p];
+        place->level = new_index[p];
+    }
+
+    net->num_places = num_places;
+    net->num_transitions = num_transitions;
+
+    free(new_index);
+}
+
+static void mark_atoms(ctl_node_t *node, void *arg) {
+    if (node->type == CTL_ATOM) {
+        char *queried = arg;
+
+        for (int i = 0; i < node->atom.num_transitions; i++) {
+            queried[node->atom.fireable_transitions[i].identifier] = 1;
+        }
+    }
+}
+
+static void find_next(ctl_node_t *node, void *arg) {
+    if (node->type == CTL_EX) *(int *) arg = 1;
+}
+
+void reduce_mark_queried(ctl_node_t *formula, char *queried, int *uses_next) {
+    ctl_visit(formula, mark_atoms, queried);
+    ctl_visit(normalize(formula), find_next, uses_next);
+}
+
+void reduce_net(andl_context_t *andl_context, const char *queried, int agglomerate_transitions) {
+    int num_places = andl_context->num_places;
+    int num_transitions = andl_context->num_transitions;
+
+    reducer_t r;
+    memset(&r, 0, sizeof(reducer_t));
+    r.net = andl_context;
+    r.queried = queried;
+    r.place_removed = calloc(num_places + 1, 1);
+    r.transition_removed = calloc(num_transitions + 1, 1);
+    r.touched = calloc(num_transitions + 1, 1);
+    r.dirty = calloc(num_places + 1, 1);
+    r.read_by_query = calloc(num_places + 1, 1);
+    r.start = mmalloc((num_places + 1) * sizeof(int));
+    r.producers = mmalloc((num_places + 1) * sizeof(int));
+    r.consumers = mmalloc((num_places + 1) * sizeof(int));
+
+    for (int t = 0; t < num_transitions; t++) {
+        if (!queried[t]) continue;
+
+        transition_t *transition = andl_context->transitions + t;
+
+        for (int i = 0; i < transition->num_arcs; i++) {
+            if (transition->arcs[i].dir == ARC_IN) r.read_by_query[place_index(&r, transition->arcs[i].place)] = 1;
+        }
+    }
+
+    double start = wctime();
+    int rounds = 0;
+    int changed = 1;
+
+    // every round applies one kind of rule, the cheap removals first
+    while (changed) {
+        collect_arcs(&r);
+        rounds++;
+
+        changed = remove_redundant(&r) || remove_implicit(&r) || (agglomerate_transitions && agglomerate(&r));
+    }
+
+    compact(&r);
+
+    for (int i = 0; i < NUM_RULES; i++) {
+        warn("Reduction by %s: %d places and %d transitions removed", rule_names[i], r.places_removed[i],
+                r.transitions_removed[i]);
+    }
+
+    warn("Reduced the net from %d places and %d transitions to %d places and %d transitions in %d rounds, %.3f s",
+            num_places, num_transitions, andl_context->num_places, andl_context->num_transitions, rounds,
+            wctime() - start);
+
+    free(r.place_removed);
+    free(r.transition_removed);
+    free(r.touched);
+    free(r.dirty);
+    free(r.read_by_query);
+    free(r.start);
+    free(r.arc_of);
+    free(r.producers);
+    free(r.consumers);
+}
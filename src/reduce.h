@@ -0,0 +1,31 @@
+#include "andl.h"
+#include "ctl.h"
+
+#ifndef REDUCE_H
+#define REDUCE_H
+
+/**
+ * Marks the transitions that occur in the atoms of \p formula in \p queried, indexed by
+ * identifier, and sets \p uses_next when the normal form of the formula contains EX.
+ */
+void reduce_mark_queried(ctl_node_t *formula, char *queried, int *uses_next);
+
+/**
+ * Reduces the 1-safe net in \p andl_context with structural rules, until none applies:
+ *  - redundant places, that are not the input of any transition, are removed,
+ *  - implicit places, that have the same arcs and initial marking as another place, are removed,
+ *  - a place with one producer and one consumer, which only consumes from that place, is removed
+ *    by fusing the two transitions (sequential fusion),
+ *  - a place whose only consumer only consumes from that place is removed by appending the
+ *    consumer to all its producers (post-agglomeration),
+ *  - a place whose only producer only produces in that place, and is the only consumer of its own
+ *    input places, is removed by prepending the producer to all its consumers (pre-agglomeration).
+ * The transitions in \p queried are never removed and keep their input places, and the
+ * agglomerations never hide a change of the fireability of those transitions. The removed
+ * intermediate steps can change the outcome of EX, so the three fusing rules are only applied when
+ * \p agglomerate is set.
+ * The places and transitions that remain are renumbered, and the removed ones are freed.
+ */
+void reduce_net(andl_context_t *andl_context, const char *queried, int agglomerate);
+
+#endif
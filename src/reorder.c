@@ -0,0 +1,304 @@
+#include <config.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "reorder.h"
+#include "util.h"
+
+// never reorder when the registered BDDs are smaller than this
+#define REORDER_MIN_SIZE 4096
+
+// the number of places sifted per reordering, most connected places first
+#define REORDER_MAX_PLACES 32
+
+// how many levels a place is moved up and down at most
+#define REORDER_WINDOW 16
+
+// stop moving a place in one direction when the size exceeds the best size by this factor
+#define REORDER_MAX_GROWTH 1.2
+
+static andl_context_t *context = NULL;
+
+// 0 when reordering is not enabled
+static double growth = 0;
+static int disabled = 0;
+
+static size_t last_size = REORDER_MIN_SIZE;
+static int num_reorders = 0;
+
+// the registered BDDs, formulas may be checked in parallel so the registry is guarded by a lock
+static pthread_mutex_t roots_lock = PTHREAD_MUTEX_INITIALIZER;
+static BDD **roots = NULL;
+static size_t num_roots = 0;
+static size_t roots_size = 0;
+
+// the place at every level
+static place_t **at_level = NULL;
+
+void reorder_init(andl_context_t *andl_context, double growth_factor) {
+    context = andl_context;
+    growth = growth_factor;
+
+    at_level = rrealloc(at_level, (andl_context->num_places + 1) * sizeof(place_t *));
+
+    for (int i = 0; i < andl_context->num_places; i++) {
+        place_t *place = andl_context->places + i;
+        at_level[place->level] = place;
+    }
+
+    warn("Dynamic reordering enabled at growth factor %.2f", growth);
+}
+
+void reorder_protect(BDD *bdd) {
+    sylvan_protect(bdd);
+
+    // without reordering there is no need to know the roots
+    if (growth == 0) return;
+
+    pthread_mutex_lock(&roots_lock);
+
+    if (num_roots == roots_size) {
+        roots_size = roots_size == 0 ? 64 : roots_size * 2;
+        roots = rrealloc(roots, roots_size * sizeof(BDD *));
+    }
+
+    roots[num_roots++] = bdd;
+
+    pthread_mutex_unlock(&roots_lock);
+}
+
+void reorder_unprotect(BDD *bdd) {
+    sylvan_unprotect(bdd);
+
+    if (growth == 0) return;
+
+    pthread_mutex_lock(&roots_lock);
+
+    // BDDs are mostly unprotected in the reverse order they were protected in
+    for (size_t i = num_roots; i > 0; i--) {
+        if (roots[i - 1] == bdd) {
+            roots[i - 1] = roots[--num_roots];
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&roots_lock);
+}
+
+void reorder_disable() {
+    disabled++;
+}
+
+void reorder_enable() {
+    disabled--;
+}
+
+/*
+ * A set of BDD nodes, with open addressing. The false terminal is 0, so 0 marks a free bucket.
+ */
+typedef struct {
+    BDD *buckets;
+    size_t capacity;
+    size_t count;
+} node_set_t;
+
+static void node_set_init(node_set_t *set, size_t capacity) {
+    set->buckets = mmalloc(capacity * sizeof(BDD));
+    memset(set->buckets, 0, capacity * sizeof(BDD));
+    set->capacity = capacity;
+    set->count = 0;
+}
+
+/*
+ * Adds \p node to \p set.
+ * \return: 1 if it was not in the set yet, 0 otherwise.
+ */
+static int node_set_add(node_set_t *set, BDD node) {
+    if (2 * (set->count + 1) > set->capacity) {
+        node_set_t bigger;
+        node_set_init(&bigger, 2 * set->capacity);
+
+        for (size_t i = 0; i < set->capacity; i++) {
+            if (set->buckets[i] != 0) node_set_add(&bigger, set->buckets[i]);
+        }
+
+        free(set->buckets);
+        *set = bigger;
+    }
+
+    size_t mask = set->capacity - 1;
+    size_t i = (size_t) ((node * 0x9e3779b97f4a7c15ull) >> 17) & mask;
+
+    while (set->buckets[i] != 0) {
+        if (set->buckets[i] == node) return 0;
+        i = (i + 1) & mask;
+    }
+
+    set->buckets[i] = node;
+    set->count++;
+    return 1;
+}
+
+/*
+ * The number of nodes of all registered BDDs. The fixpoint iterates, the cached results of the
+ * formulas and the relations share most of their nodes, so every node is counted once, however
+ * many of the BDDs it is in.
+ */
+static size_t live_size() {
+    node_set_t visited;
+    node_set_init(&visited, 1024);
+
+    size_t stack_size = 1024;
+    size_t top = 0;
+    BDD *stack = mmalloc(stack_size * sizeof(BDD));
+
+    for (size_t i = 0; i < num_roots; i++) {
+        stack[top++] = *roots[i];
+
+        while (top > 0) {
+            BDD bdd = stack[--top];
+
+            // a node and its complement are the same node
+            if (sylvan_isconst(bdd) || !node_set_add(&visited, bdd & ~sylvan_complement)) continue;
+
+            if (top + 2 > stack_size) {
+                stack_size *= 2;
+                stack = rrealloc(stack, stack_size * sizeof(BDD));
+            }
+
+            stack[top++] = sylvan_low(bdd);
+            stack[top++] = sylvan_high(bdd);
+        }
+    }
+
+    free(visited.buckets);
+    free(stack);
+
+    return visited.count;
+}
+
+/*
+ * Swap the place at the given level with the place below it, in all registered BDDs.
+ */
+static void swap_levels(int level) {
+    LACE_ME;
+
+    BDDVAR x = 2 * level;
+    BDDVAR y = 2 * (level + 1);
+
+    // the normal and primed variables of both places move together
+    BDD map = sylvan_map_empty();
+    sylvan_protect(&map);
+
+    map = sylvan_map_add(map, x, sylvan_ithvar(y));
+    map = sylvan_map_add(map, x + 1, sylvan_ithvar(y + 1));
+    map = sylvan_map_add(map, y, sylvan_ithvar(x));
+    map = sylvan_map_add(map, y + 1, sylvan_ithvar(x + 1));
+
+    for (size_t i = 0; i < num_roots; i++) {
+        *roots[i] = sylvan_compose(*roots[i], map);
+    }
+
+    sylvan_unprotect(&map);
+
+    place_t *place = at_level[level];
+    at_level[level] = at_level[level + 1];
+    at_level[level + 1] = place;
+
+    at_level[level]->level = level;
+    at_level[level + 1]->level = level + 1;
+}
+
+/*
+ * Move the given place within the window around its level, and leave it at the level where the
+ * registered BDDs are smallest.
+ */
+static size_t sift_place(place_t *place, size_t size) {
+    int n = context->num_places;
+    int lo = place->level - REORDER_WINDOW < 0 ? 0 : place->level - REORDER_WINDOW;
+    int hi = place->level + REORDER_WINDOW >= n ? n - 1 : place->level + REORDER_WINDOW;
+
+    size_t best = size;
+    int best_level = place->level;
+
+    // first move towards the closest end of the window
+    for (int pass = 0; pass < 2; pass++) {
+        int down = (pass == 0) == (hi - place->level < place->level - lo);
+
+        while (down ? place->level < hi : place->level > lo) {
+            swap_levels(down ? place->level : place->level - 1);
+
+            size = live_size();
+            if (size < best) {
+                best = size;
+                best_level = place->level;
+            } else if (size > REORDER_MAX_GROWTH * best) {
+                break;
+            }
+        }
+    }
+
+    while (place->level < best_level) swap_levels(place->level);
+    while (place->level > best_level) swap_levels(place->level - 1);
+
+    return best;
+}
+
+typedef struct {
+    place_t *place;
+    int degree;
+} sift_candidate_t;
+
+static int compare_degree(const void *a, const void *b) {
+    return ((const sift_candidate_t *) b)->degree - ((const sift_candidate_t *) a)->degree;
+}
+
+void reorder_now() {
+    if (context == NULL) return;
+
+    int n = context->num_places;
+    sift_candidate_t *candidates = mmalloc((n + 1) * sizeof(sift_candidate_t));
+
+    for (int i = 0; i < n; i++) {
+        candidates[i].place = context->places + i;
+        candidates[i].degree = 0;
+    }
+
+    for (int t = 0; t < context->num_transitions; t++) {
+        transition_t *transition = context->transitions + t;
+
+        for (int i = 0; i < transition->num_arcs; i++) {
+            candidates[transition->arcs[i].place->identifier].degree++;
+        }
+    }
+
+    qsort(candidates, n, sizeof(sift_candidate_t), compare_degree);
+
+    double start = wctime();
+    size_t before = live_size();
+    size_t size = before;
+
+    for (int i = 0; i < n && i < REORDER_MAX_PLACES; i++) {
+        size = sift_place(candidates[i].place, size);
+    }
+
+    num_reorders++;
+    last_size = size > REORDER_MIN_SIZE ? size : REORDER_MIN_SIZE;
+
+    warn("Reordering %d: %zu -> %zu nodes (%.1f%% smaller) in %.3f s",
+            num_reorders, before, size, before > 0 ? 100.0 * (before - size) / before : 0.0, wctime() - start);
+
+    free(candidates);
+}
+
+int reorder_maybe() {
+    if (growth == 0 || disabled) return 0;
+
+    size_t size = live_size();
+    if (size <= growth * last_size) return 0;
+
+    reorder_now();
+    return 1;
+}
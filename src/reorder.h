@@ -0,0 +1,52 @@
+#include <sylvan.h>
+#include "andl.h"
+
+#ifndef REORDER_H
+#define REORDER_H
+
+/**
+ * Dynamic variable reordering by sifting. Sylvan does not reorder by itself, so every BDD that is
+ * alive when a reordering may happen must be registered here with reorder_protect: it is then
+ * protected from garbage collection, and rewritten to the new variable order whenever the places
+ * are moved. The levels of the places in the andl_context are updated along, so anything derived
+ * from the levels (such as the top of a relation) must be recomputed after a reordering.
+ */
+
+/**
+ * Enables dynamic reordering of the places of \p andl_context. A reordering is triggered when the
+ * number of nodes of the registered BDDs, shared nodes counted once, has grown by \p growth since
+ * the previous reordering.
+ * Must be called before any BDD is registered.
+ */
+void reorder_init(andl_context_t *andl_context, double growth);
+
+/**
+ * Protects \p bdd from garbage collection, and registers it to be remapped on reordering.
+ */
+void reorder_protect(BDD *bdd);
+
+/**
+ * Undoes reorder_protect.
+ */
+void reorder_unprotect(BDD *bdd);
+
+/**
+ * Disables or re-enables reordering, e.g. around code that keeps BDDs that are not registered, or
+ * while several tasks check formulas in parallel. Calls nest.
+ */
+void reorder_disable();
+void reorder_enable();
+
+/**
+ * Reorders if the registered BDDs have grown past the threshold. Must only be called when every
+ * live BDD is registered.
+ * \return: 1 if the variables were reordered, 0 otherwise.
+ */
+int reorder_maybe();
+
+/**
+ * Sifts the places now, regardless of the threshold.
+ */
+void reorder_now();
+
+#endif
@@ -1,82 +1,389 @@
 #include "smc.h"
 
+#include <string.h>
+
 #include <sylvan.h>
 
+#include "cone.h"
+#include "reach.h"
 #include "state_space.h"
+#include "reorder.h"
+#include "util.h"
+
+int parse_smc_engine(const char *name, smc_engine_t *engine) {
+	if (strcmp(name, "global") == 0) {
+		*engine = SMC_GLOBAL;
+	} else if (strcmp(name, "sat") == 0) {
+		*engine = SMC_SATURATION;
+	} else {
+		return 1;
+	}
+
+	return 0;
+}
+
+static const char *eg_names[] = { "el", "owcty", "lockstep" };
+
+int parse_eg_algorithm(const char *name, eg_algorithm_t *eg) {
+	for (int i = 0; i < (int) (sizeof(eg_names) / sizeof(eg_names[0])); i++) {
+		if (strcmp(name, eg_names[i]) == 0) {
+			*eg = (eg_algorithm_t) i;
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+smc_model_t *build_model(andl_context_t *andl_context, size_t cluster_threshold) {
+	smc_model_t *model = malloc(sizeof(smc_model_t));
+
+	model->intial_state = generate_initial_state(andl_context);
+	reorder_protect(&model->intial_state);
+
+	model->transitions = generate_relations(andl_context);
+	model->num_transitions = andl_context->num_transitions;
 
-int check(andl_context_t *andl_context, ctl_node_t *formula) {
+	model->num_levels = count_levels(andl_context);
+
+	model->partitions = cluster_relations(model->transitions, model->num_transitions, model->num_levels,
+			cluster_threshold, &model->num_partitions);
+
+	model->reachable = sylvan_true;
+	reorder_protect(&model->reachable);
+
+	model->restrict_reachable = 0;
+	model->engine = SMC_SATURATION;
+	model->eg = EG_EMERSON_LEI;
+	model->on_the_fly = 1;
+
+	return model;
+}
+
+/*
+ * The model of the cone of influence of a formula. It shares the relations of the transitions in
+ * the cone with the full model, and the places outside the cone are quantified out of the initial
+ * state, so no set mentions them.
+ */
+smc_model_t *slice_model(smc_model_t *model, andl_context_t *andl_context, ctl_node_t *formula,
+		size_t cluster_threshold) {
 	LACE_ME;
-	
-	BDD intial_state = generate_initial_state(andl_context);
-	sylvan_protect(&intial_state);
-	
-	BDD relation = sylvan_false;
-	sylvan_protect(&relation);
 
-	BDD vars = sylvan_set_empty();
-	sylvan_protect(&vars);
+	// the results of the subformulas are shared with the full model, so they must be the same sets
+	if (model->restrict_reachable || !cone_preserves(formula)) return model;
 
-	for (int i = 0; i < andl_context->num_transitions; i++) {
-		BDD rel = generate_relation(andl_context->transitions + i);
-		sylvan_protect(&rel);
+	char *places = malloc(andl_context->num_places + 1);
+	char *transitions = malloc(andl_context->num_transitions + 1);
 
-		relation = sylvan_or(relation, rel);
+	int num_places = cone_of_influence(andl_context, formula, places, transitions);
 
-		sylvan_unprotect(&rel);
+	if (num_places == andl_context->num_places) {
+		free(places);
+		free(transitions);
+		return model;
+	}
+
+	smc_model_t *slice = malloc(sizeof(smc_model_t));
+	*slice = *model;
+
+	BDDSET inside = sylvan_set_empty();
+	BDDSET outside = sylvan_set_empty();
+	sylvan_protect(&inside);
+	sylvan_protect(&outside);
+
+	// a level is only quantified out when no place of the cone is encoded in it
+	for (int i = 0; i < andl_context->num_places; i++) {
+		if (places[i]) inside = add_place_vars(inside, andl_context->places + i);
+	}
+
+	for (int level = 0; level < model->num_levels; level++) {
+		if (!sylvan_set_in(inside, 2 * level)) outside = sylvan_set_add(outside, 2 * level);
+	}
 
-		BDD variables = generate_vars(andl_context->transitions + i);
-		sylvan_protect(&variables);
+	slice->intial_state = sylvan_exists(model->intial_state, outside);
+	reorder_protect(&slice->intial_state);
 
-		// add all variables used in this relation to the set of all variables that occurs in a relation
-		while(!sylvan_set_isempty(variables)) {
-			vars = sylvan_set_add(vars, sylvan_set_first(variables));
-			variables = sylvan_set_next(variables);
+	sylvan_unprotect(&inside);
+	sylvan_unprotect(&outside);
+
+	slice->transitions = malloc((model->num_transitions + 1) * sizeof(relation_t));
+	slice->num_transitions = 0;
+
+	for (int i = 0; i < model->num_transitions; i++) {
+		if (!transitions[i]) continue;
+
+		relation_t *relation = slice->transitions + slice->num_transitions++;
+		*relation = model->transitions[i];
+		reorder_protect(&relation->relation);
+		reorder_protect(&relation->variables);
+	}
+
+	slice->partitions = cluster_relations(slice->transitions, slice->num_transitions, model->num_levels,
+			cluster_threshold, &slice->num_partitions);
+
+	slice->reachable = sylvan_true;
+	reorder_protect(&slice->reachable);
+
+	warn("Cone of influence: %d of %d places, %d of %d transitions", num_places, andl_context->num_places,
+			slice->num_transitions, model->num_transitions);
+
+	free(places);
+	free(transitions);
+
+	return slice;
+}
+
+void free_model(smc_model_t *model) {
+	reorder_unprotect(&model->intial_state);
+	reorder_unprotect(&model->reachable);
+
+	free_relations(model->transitions, model->num_transitions);
+	free_relations(model->partitions, model->num_partitions);
+
+	free(model);
+}
+
+static int is_true(ctl_node_t *formula) {
+	return formula->type == CTL_ATOM && formula->atom.num_transitions == -1;
+}
+
+/*
+ * Decide whether a state in \p target is reachable from the initial state, by a forward search
+ * from the initial state and a backward search from the target at the same time. Every step
+ * advances the search with the smaller frontier, and the first search that meets the other end or
+ * runs out of new states decides. The layer at which that happened is logged.
+ */
+static int reachable(smc_model_t *model, BDD target, const char *name) {
+	LACE_ME;
+
+	BDD forward = model->intial_state;
+	BDD forward_front = forward;
+	BDD backward = target;
+	BDD backward_front = target;
+	reorder_protect(&forward);
+	reorder_protect(&forward_front);
+	reorder_protect(&backward);
+	reorder_protect(&backward_front);
+
+	int forward_layer = 0, backward_layer = 0;
+	int result;
+	const char *direction;
+
+	while (1) {
+		if (sylvan_and(forward_front, target) != sylvan_false) {
+			result = 1, direction = "forward";
+			break;
+		}
+
+		if (sylvan_and(backward_front, model->intial_state) != sylvan_false) {
+			result = 1, direction = "backward";
+			break;
+		}
+
+		if (forward_front == sylvan_false) {
+			result = 0, direction = "forward";
+			break;
+		}
+
+		if (backward_front == sylvan_false) {
+			result = 0, direction = "backward";
+			break;
 		}
 
-		sylvan_unprotect(&variables);
+		if (sylvan_nodecount(forward_front) <= sylvan_nodecount(backward_front)) {
+			forward_front = sylvan_and(post(model, forward_front), sylvan_not(forward));
+			forward = sylvan_or(forward, forward_front);
+			forward_layer++;
+		} else {
+			backward_front = sylvan_and(pre(model, backward_front), sylvan_not(backward));
+			backward = sylvan_or(backward, backward_front);
+			backward_layer++;
+		}
+
+		reorder_maybe();
+	}
+
+	warn("%s decided by the %s search at layer %d (%d forward and %d backward layers)", name, direction,
+			direction[0] == 'f' ? forward_layer : backward_layer, forward_layer, backward_layer);
+
+	reorder_unprotect(&forward);
+	reorder_unprotect(&forward_front);
+	reorder_unprotect(&backward);
+	reorder_unprotect(&backward_front);
+
+	return result;
+}
+
+int check(smc_model_t *model, ctl_node_t *formula) {
+	LACE_ME;
+
+	// a top-level EF p, normalized to E[true U p], or AG p, normalized to !E[true U !p], only asks
+	// whether a state is reachable, which does not need the whole fixpoint
+	if (model->on_the_fly && formula->result == sylvan_invalid) {
+		if (formula->type == CTL_EU && is_true(formula->binary.left)) {
+			return reachable(model, check_BDD(model, formula->binary.right), "EF");
+		}
+
+		if (formula->type == CTL_NEGATION) {
+			ctl_node_t *child = formula->unary.child;
+
+			if (child->result == sylvan_invalid && child->type == CTL_EU && is_true(child->binary.left)) {
+				return !reachable(model, check_BDD(model, child->binary.right), "AG");
+			}
+		}
 	}
-	
-	smc_model_t *model = malloc(sizeof(smc_model_t));
-	model->relation = relation;
-	model->variables = vars;
 
 	BDD state_space = check_BDD(model, formula);
-	sylvan_protect(&state_space);
+	reorder_protect(&state_space);
 
-	// printf("SMC SAT count: %f\n", mtbdd_satcount(state_space, andl_context->num_places));
+	// printf("SMC SAT count: %f\n", mtbdd_satcount(state_space, model->num_levels));
 
 	// check if the initial state is in the state space
-	int result = sylvan_and(intial_state, sylvan_not(state_space)) == sylvan_false;
+	int result = sylvan_and(model->intial_state, sylvan_not(state_space)) == sylvan_false;
 
-	sylvan_unprotect(&intial_state);
-	sylvan_unprotect(&state_space);
-	sylvan_unprotect(&relation);
-	sylvan_unprotect(&vars);
+	reorder_unprotect(&state_space);
 
 	return result;
 }
 
+VOID_TASK_4(check_task, smc_model_t *, model, ctl_node_t *, formula, int *, result, double *, time)
+{
+	double start = wctime();
+
+	*result = check(model, formula);
+	*time = wctime() - start;
+}
+
+void check_parallel(smc_model_t **models, ctl_node_t **formulas, int num_formulas, int *results, double *times) {
+	LACE_ME;
+
+	// the registered BDDs cannot be rewritten while other tasks use them
+	reorder_disable();
+
+	for (int i = 0; i < num_formulas; i++) {
+		SPAWN(check_task, models[i], formulas[i], results + i, times + i);
+	}
+
+	// tasks are synced in the reverse order they were spawned in
+	for (int i = 0; i < num_formulas; i++) {
+		SYNC(check_task);
+	}
+
+	reorder_enable();
+}
+
+/*
+ * Intersect the given states with the reachable states, if the model restricts to those. Every
+ * set computed by check_BDD is restricted, so the fixpoints only range over reachable states.
+ */
+static BDD restrict_states(smc_model_t *model, BDD states) {
+	LACE_ME;
+
+	return model->restrict_reachable ? sylvan_and(states, model->reachable) : states;
+}
+
+/*
+ * Compute the predecessors of the given states, as the union of the predecessors under every
+ * partition of the transition relation.
+ */
+BDD pre(smc_model_t *model, BDD states) {
+	LACE_ME;
+
+	BDD result = sylvan_false;
+	sylvan_protect(&result);
+
+	for (int i = 0; i < model->num_partitions; i++) {
+		result = sylvan_or(result, preimage(states, model->partitions + i));
+	}
+
+	result = restrict_states(model, result);
+
+	sylvan_unprotect(&result);
+	return result;
+}
+
+/*
+ * Compute the successors of the given states, as the union of the successors under every
+ * partition of the transition relation.
+ */
+BDD post(smc_model_t *model, BDD states) {
+	LACE_ME;
+
+	BDD result = sylvan_false;
+	sylvan_protect(&result);
+
+	for (int i = 0; i < model->num_partitions; i++) {
+		result = sylvan_or(result, image(states, model->partitions + i));
+	}
+
+	result = restrict_states(model, result);
+
+	sylvan_unprotect(&result);
+	return result;
+}
+
 BDD check_BDD(smc_model_t *model, ctl_node_t *formula) {
+	// formulas are shared between all formulas of a run, so their result may already be known
+	if (formula->result != sylvan_invalid) {
+		return formula->result;
+	}
+
+	BDD result;
+
 	switch(formula->type) {
 		case CTL_ATOM:
-			return check_BDD_atom(model, formula);
+			result = check_BDD_atom(model, formula);
+			break;
 		case CTL_NEGATION:
-			return check_BDD_negation(model, formula);
+			result = check_BDD_negation(model, formula);
+			break;
 		case CTL_CONJUNCTION:
-			return check_BDD_conjunction(model, formula);
+			result = check_BDD_conjunction(model, formula);
+			break;
 		case CTL_DISJUNCTION:
 			// not stricty needed, but implementation is simple so it's not reduced in ctl.c
-			return check_BDD_disjunction(model, formula);
+			result = check_BDD_disjunction(model, formula);
+			break;
 		case CTL_EX:
-			return check_BDD_EX(model, formula);
+			result = check_BDD_EX(model, formula);
+			break;
 		case CTL_EU:
-			return check_BDD_EU(model, formula);
-		case CTL_EG:
-			return check_BDD_EG(model, formula);
+			if (model->engine == SMC_SATURATION) {
+				result = check_BDD_EU_saturation(model, formula);
+			} else {
+				result = check_BDD_EU(model, formula);
+			}
+			break;
+		case CTL_EG: {
+			double start = wctime();
+			const char *algorithm = eg_names[model->eg];
+
+			if (model->eg == EG_OWCTY) {
+				result = check_BDD_EG_owcty(model, formula);
+			} else if (model->eg == EG_LOCKSTEP) {
+				result = check_BDD_EG_lockstep(model, formula);
+			} else if (model->engine == SMC_SATURATION) {
+				result = check_BDD_EG_saturation(model, formula);
+				algorithm = "saturation";
+			} else {
+				result = check_BDD_EG(model, formula);
+			}
+
+			warn("EG with %s: %.3f s", algorithm, wctime() - start);
+			break;
+		}
 		default:
 			printf("Unknown case in check_BDD\n");
 			return (BDD) NULL;
 	}
+
+	// when formulas are checked in parallel, another task may have computed the same subformula;
+	// the results are canonical BDDs, so only the first one is stored and protected
+	if (__sync_bool_compare_and_swap(&formula->result, sylvan_invalid, result)) {
+		reorder_protect(&formula->result);
+	}
+
+	return result;
 }
 
 BDD check_BDD_atom(smc_model_t *model, ctl_node_t *formula) {
@@ -103,9 +410,7 @@ BDD check_BDD_atom(smc_model_t *model, ctl_node_t *formula) {
 				arc_t arc = transition->arcs[j];
 
 				if (arc.dir == ARC_IN) {
-					int identifier = arc.place->identifier;
-
-					transition_pre = sylvan_and(transition_pre, sylvan_ithvar(2 * identifier));
+					transition_pre = sylvan_and(transition_pre, place_marked(arc.place, 0));
 				}
 			}
 
@@ -115,6 +420,8 @@ BDD check_BDD_atom(smc_model_t *model, ctl_node_t *formula) {
 		}
 	}
 
+	result = restrict_states(model, result);
+
 	sylvan_unprotect(&result);
 	return result;
 }
@@ -122,22 +429,22 @@ BDD check_BDD_atom(smc_model_t *model, ctl_node_t *formula) {
 BDD check_BDD_negation(smc_model_t *model, ctl_node_t *formula) {
 	LACE_ME;
 
-	return sylvan_not(check_BDD(model, formula->unary.child));
+	return restrict_states(model, sylvan_not(check_BDD(model, formula->unary.child)));
 }
 
 BDD check_BDD_conjunction(smc_model_t *model, ctl_node_t *formula) {
 	LACE_ME;
 
 	BDD left = check_BDD(model, formula->binary.left);
-	sylvan_protect(&left);
+	reorder_protect(&left);
 
 	BDD right = check_BDD(model, formula->binary.right);
-	sylvan_protect(&right);
+	reorder_protect(&right);
 
 	BDD result = sylvan_and(left, right);
 	
-	sylvan_unprotect(&left);
-	sylvan_unprotect(&right);
+	reorder_unprotect(&left);
+	reorder_unprotect(&right);
 
 	return result;
 }
@@ -146,15 +453,15 @@ BDD check_BDD_disjunction(smc_model_t *model, ctl_node_t *formula) {
 	LACE_ME;
 
 	BDD left = check_BDD(model, formula->binary.left);
-	sylvan_protect(&left);
+	reorder_protect(&left);
 
 	BDD right = check_BDD(model, formula->binary.right);
-	sylvan_protect(&right);
+	reorder_protect(&right);
 
 	BDD result = sylvan_or(left, right);
 	
-	sylvan_unprotect(&left);
-	sylvan_unprotect(&right);
+	reorder_unprotect(&left);
+	reorder_unprotect(&right);
 
 	return result;
 }
@@ -163,51 +470,337 @@ BDD check_BDD_EX(smc_model_t *model, ctl_node_t *formula) {
 	LACE_ME;
 
 	BDD space = check_BDD(model, formula->unary.child);
-	sylvan_protect(&space);
+	reorder_protect(&space);
 
-	BDD result = sylvan_relprev(model->relation, space, model->variables);
+	BDD result = pre(model, space);
 
-	sylvan_unprotect(&space);
+	reorder_unprotect(&space);
 
 	return result;
 }
 
+/*
+ * E[a U b] as a least fixpoint. Only the states added in the previous iteration can have
+ * predecessors that are not found yet, so the pre-image is only taken of that frontier.
+ */
+static BDD until_frontier(smc_model_t *model, BDD a, BDD b) {
+	LACE_ME;
+
+	BDD z = b;
+	BDD frontier = b;
+	reorder_protect(&z);
+	reorder_protect(&frontier);
+
+	int iteration = 0;
+
+	while (frontier != sylvan_false) {
+		double t = wctime();
+		frontier = pre(model, frontier);
+		double pre_time = wctime() - t;
+
+		frontier = sylvan_and(frontier, sylvan_and(a, sylvan_not(z)));
+		z = sylvan_or(z, frontier);
+
+		iteration++;
+		warn("EU iteration %d: pre-image %.3f s, frontier of %.0f states in %zu nodes",
+				iteration, pre_time, mtbdd_satcount(frontier, model->num_levels), sylvan_nodecount(frontier));
+
+		reorder_maybe();
+	}
+
+	reorder_unprotect(&z);
+	reorder_unprotect(&frontier);
+
+	return z;
+}
+
+/*
+ * E[a U b] with the fixpoint engine of the model.
+ */
+static BDD until(smc_model_t *model, BDD a, BDD b) {
+	if (model->engine == SMC_SATURATION) {
+		return saturate_backward(b, a, model->transitions, model->num_transitions, model->num_levels);
+	} else {
+		return until_frontier(model, a, b);
+	}
+}
+
 BDD check_BDD_EU(smc_model_t *model, ctl_node_t *formula) {
+	BDD a = check_BDD(model, formula->binary.left);
+	reorder_protect(&a);
+
+	BDD b = check_BDD(model, formula->binary.right);
+	reorder_protect(&b);
+
+	BDD result = until_frontier(model, a, b);
+
+	reorder_unprotect(&a);
+	reorder_unprotect(&b);
+
+	return result;
+}
+
+BDD check_BDD_EG(smc_model_t *model, ctl_node_t *formula) {
 	LACE_ME;
 	
+	BDD a = check_BDD(model, formula->unary.child);
+	reorder_protect(&a);
+
+	BDD z = a;
+	BDD old = (BDD) NULL; //assume BDD identifiers are never equal to NULL
+	reorder_protect(&z);
+	reorder_protect(&old);
+
+	while (z != old) {
+		old = z;
+		z = sylvan_and(z, pre(model, z));
+
+		reorder_maybe();
+	}
+
+	reorder_unprotect(&a);
+	reorder_unprotect(&z);
+	reorder_unprotect(&old);
+
+	return z;
+}
+/*
+ * E[a U b] as the backward saturation of b, constrained to a.
+ */
+BDD check_BDD_EU_saturation(smc_model_t *model, ctl_node_t *formula) {
 	BDD a = check_BDD(model, formula->binary.left);
-	sylvan_protect(&a);
+	reorder_protect(&a);
 
 	BDD b = check_BDD(model, formula->binary.right);
-	sylvan_protect(&b);
+	reorder_protect(&b);
 
-	BDD z = b;
+	BDD result = saturate_backward(b, a, model->transitions, model->num_transitions, model->num_levels);
+
+	reorder_unprotect(&a);
+	reorder_unprotect(&b);
+
+	return result;
+}
+
+/*
+ * EG a as the greatest fixpoint of Z = E[a U (a and EX Z)]: every state of such a Z can reach,
+ * along a, a state in a that has a successor in Z again, so it has an infinite path through a.
+ * The inner least fixpoint is computed by backward saturation.
+ */
+BDD check_BDD_EG_saturation(smc_model_t *model, ctl_node_t *formula) {
+	LACE_ME;
+
+	BDD a = check_BDD(model, formula->unary.child);
+	reorder_protect(&a);
+
+	BDD z = a;
 	BDD old = (BDD) NULL; //assume BDD identifiers are never equal to NULL
+	BDD step = sylvan_false;
+	reorder_protect(&z);
+	reorder_protect(&old);
+	reorder_protect(&step);
+
 	while (z != old) {
 		old = z;
-		z = sylvan_or(z, sylvan_and(a, sylvan_relprev(model->relation, z, model->variables)));
+		step = sylvan_and(a, pre(model, z));
+		z = saturate_backward(step, a, model->transitions, model->num_transitions, model->num_levels);
+
+		reorder_maybe();
 	}
 
-	sylvan_unprotect(&a);
-	sylvan_unprotect(&b);
+	reorder_unprotect(&a);
+	reorder_unprotect(&z);
+	reorder_unprotect(&old);
+	reorder_unprotect(&step);
 
 	return z;
 }
 
-BDD check_BDD_EG(smc_model_t *model, ctl_node_t *formula) {
+/*
+ * EG a by OWCTY-style trimming: states without a successor and states without a predecessor in
+ * the set are removed until nothing changes. What remains is the SCC hull, which contains every
+ * cycle through a and in which every state has a successor, so EG a = E[a U hull].
+ */
+BDD check_BDD_EG_owcty(smc_model_t *model, ctl_node_t *formula) {
 	LACE_ME;
-	
+
 	BDD a = check_BDD(model, formula->unary.child);
-	sylvan_protect(&a);
+	reorder_protect(&a);
 
 	BDD z = a;
 	BDD old = (BDD) NULL; //assume BDD identifiers are never equal to NULL
+	reorder_protect(&z);
+	reorder_protect(&old);
+
+	int rounds = 0;
+
 	while (z != old) {
 		old = z;
-		z = sylvan_and(z, sylvan_relprev(model->relation, z, model->variables));
+		z = sylvan_and(z, pre(model, z));
+		z = sylvan_and(z, post(model, z));
+		rounds++;
+
+		reorder_maybe();
 	}
 
-	sylvan_unprotect(&a);
+	warn("OWCTY: %d trimming rounds, hull of %.0f states", rounds, mtbdd_satcount(z, model->num_levels));
 
-	return z;
-}
\ No newline at end of file
+	BDD result = until(model, a, z);
+
+	reorder_unprotect(&a);
+	reorder_unprotect(&z);
+	reorder_unprotect(&old);
+
+	return result;
+}
+
+/*
+ * A stack of sets still to be decomposed by the lockstep search. The sets are referenced while
+ * they are on the stack.
+ */
+typedef struct {
+	BDD *sets;
+	int size;
+	int capacity;
+} set_stack_t;
+
+static void stack_push(set_stack_t *stack, BDD set) {
+	if (set == sylvan_false) return;
+
+	if (stack->size == stack->capacity) {
+		stack->capacity *= 2;
+		stack->sets = rrealloc(stack->sets, stack->capacity * sizeof(BDD));
+	}
+
+	stack->sets[stack->size++] = sylvan_ref(set);
+}
+
+/*
+ * Decompose the given set into its SCCs with the lockstep search of Bloem, Gabow and Somenzi, and
+ * return the union of its nontrivial SCCs. The forward and backward sets of a seed are grown one
+ * step at a time in turn; when one of them converges, the SCC of the seed is its intersection with
+ * the other, which is completed only as far as it overlaps the converged set. The converged set
+ * minus the SCC and the rest of the set are decomposed further.
+ */
+static BDD lockstep(smc_model_t *model, BDD set, BDDSET variables) {
+	LACE_ME;
+
+	BDD cycles = sylvan_false;
+	BDD v = sylvan_false, seed = sylvan_false;
+	BDD forward = sylvan_false, backward = sylvan_false;
+	BDD forward_front = sylvan_false, backward_front = sylvan_false;
+	BDD converged = sylvan_false, scc = sylvan_false;
+	sylvan_protect(&cycles);
+	sylvan_protect(&v);
+	sylvan_protect(&seed);
+	sylvan_protect(&forward);
+	sylvan_protect(&backward);
+	sylvan_protect(&forward_front);
+	sylvan_protect(&backward_front);
+	sylvan_protect(&converged);
+	sylvan_protect(&scc);
+
+	set_stack_t stack = { mmalloc(16 * sizeof(BDD)), 0, 16 };
+	stack_push(&stack, set);
+
+	int num_sccs = 0, nontrivial = 0, steps = 0;
+
+	while (stack.size > 0) {
+		v = stack.sets[--stack.size];
+		sylvan_deref(v);
+
+		seed = sylvan_pick_single_cube(v, variables);
+
+		forward = forward_front = seed;
+		backward = backward_front = seed;
+
+		while (forward_front != sylvan_false && backward_front != sylvan_false) {
+			forward_front = sylvan_and(post(model, forward_front), sylvan_and(v, sylvan_not(forward)));
+			forward = sylvan_or(forward, forward_front);
+
+			backward_front = sylvan_and(pre(model, backward_front), sylvan_and(v, sylvan_not(backward)));
+			backward = sylvan_or(backward, backward_front);
+
+			steps++;
+		}
+
+		if (forward_front == sylvan_false) {
+			converged = forward;
+
+			while (sylvan_and(backward_front, forward) != sylvan_false) {
+				backward_front = sylvan_and(pre(model, backward_front), sylvan_and(v, sylvan_not(backward)));
+				backward = sylvan_or(backward, backward_front);
+				steps++;
+			}
+		} else {
+			converged = backward;
+
+			while (sylvan_and(forward_front, backward) != sylvan_false) {
+				forward_front = sylvan_and(post(model, forward_front), sylvan_and(v, sylvan_not(forward)));
+				forward = sylvan_or(forward, forward_front);
+				steps++;
+			}
+		}
+
+		scc = sylvan_and(forward, backward);
+		num_sccs++;
+
+		// an SCC of a single state only has a cycle if the state has a self-loop
+		if (scc != seed || sylvan_and(seed, pre(model, seed)) != sylvan_false) {
+			cycles = sylvan_or(cycles, scc);
+			nontrivial++;
+		}
+
+		stack_push(&stack, sylvan_and(converged, sylvan_not(scc)));
+		stack_push(&stack, sylvan_and(v, sylvan_not(converged)));
+	}
+
+	warn("Lockstep: %d SCCs, %d nontrivial, %d image steps", num_sccs, nontrivial, steps);
+
+	free(stack.sets);
+
+	sylvan_unprotect(&cycles);
+	sylvan_unprotect(&v);
+	sylvan_unprotect(&seed);
+	sylvan_unprotect(&forward);
+	sylvan_unprotect(&backward);
+	sylvan_unprotect(&forward_front);
+	sylvan_unprotect(&backward_front);
+	sylvan_unprotect(&converged);
+	sylvan_unprotect(&scc);
+
+	return cycles;
+}
+
+/*
+ * EG a by SCC decomposition: the states with an infinite path through a are those that can reach,
+ * along a, a nontrivial SCC of the states satisfying a.
+ */
+BDD check_BDD_EG_lockstep(smc_model_t *model, ctl_node_t *formula) {
+	LACE_ME;
+
+	BDD a = check_BDD(model, formula->unary.child);
+	reorder_protect(&a);
+
+	BDDSET variables = sylvan_set_empty();
+	sylvan_protect(&variables);
+
+	for (int level = model->num_levels - 1; level >= 0; level--) {
+		variables = sylvan_set_add(variables, 2 * level);
+	}
+
+	// the search does not register its sets for reordering
+	reorder_disable();
+	BDD cycles = lockstep(model, a, variables);
+	reorder_enable();
+
+	reorder_protect(&cycles);
+
+	BDD result = until(model, a, cycles);
+
+	reorder_unprotect(&a);
+	reorder_unprotect(&cycles);
+	sylvan_unprotect(&variables);
+
+	return result;
+}
@@ -1,18 +1,117 @@
 #include <sylvan.h>
 #include "ctl.h"
 #include "andl.h"
+#include "state_space.h"
 
 #ifndef SMC_H
 #define SMC_H
 
+/**
+ * \brief The algorithms for the EU and EG fixpoints.
+ *  - SMC_GLOBAL iterates the pre-image of the whole partitioned relation, the reference engine,
+ *  - SMC_SATURATION saturates backward with the relations of the transitions ordered by their
+ *    top level.
+ */
+typedef enum {
+    SMC_GLOBAL,
+    SMC_SATURATION,
+} smc_engine_t;
+
+/**
+ * Parses the name of a fixpoint engine as given on the command line.
+ * \return: 0 on success, 1 if the name is unknown.
+ */
+int parse_smc_engine(const char *name, smc_engine_t *engine);
+
+/**
+ * \brief The algorithms for EG.
+ *  - EG_EMERSON_LEI is the greatest fixpoint iteration of the chosen engine,
+ *  - EG_OWCTY trims states without successors or predecessors down to the SCC hull,
+ *  - EG_LOCKSTEP decomposes the states into SCCs with the lockstep search.
+ * The last two reach the cycles they find with E[a U cycles].
+ */
+typedef enum {
+    EG_EMERSON_LEI,
+    EG_OWCTY,
+    EG_LOCKSTEP,
+} eg_algorithm_t;
+
+/**
+ * Parses the name of an EG algorithm as given on the command line: el, owcty or lockstep.
+ * \return: 0 on success, 1 if the name is unknown.
+ */
+int parse_eg_algorithm(const char *name, eg_algorithm_t *eg);
+
+/**
+ * The symbolic model of a Petri net. It is built once after parsing, and shared by the
+ * reachability analysis and the checks of all formulas. All BDDs in it are registered with
+ * reorder_protect.
+ */
 typedef struct
 {
     BDD intial_state;
-    BDD relation;
-    BDD variables;
+
+    // the relation of every transition
+    relation_t *transitions;
+    int num_transitions;
+
+    // the transition relation, disjunctively partitioned into clusters of transitions
+    relation_t *partitions;
+    int num_partitions;
+
+    // the number of place levels in the encoding
+    int num_levels;
+
+    // the reachable states, sylvan_true until they are computed
+    BDD reachable;
+
+    // whether the fixpoints are restricted to the reachable states
+    int restrict_reachable;
+
+    // the algorithm for the EU and EG fixpoints
+    smc_engine_t engine;
+
+    // the algorithm for EG
+    eg_algorithm_t eg;
+
+    // whether top-level EF and AG formulas are decided by a search from both ends
+    int on_the_fly;
 } smc_model_t;
 
-int check(andl_context_t *model, ctl_node_t *formula);
+/**
+ * Builds the model of the net in \p andl_context.
+ * \p cluster_threshold: the maximum number of nodes of a cluster of transition relations, 0 keeps
+ * one relation per transition.
+ */
+smc_model_t *build_model(andl_context_t *andl_context, size_t cluster_threshold);
+
+void free_model(smc_model_t *model);
+
+/**
+ * Builds the model of the cone of influence of the normalized \p formula, see cone.h. Returns
+ * \p model itself when the cone is the whole net, or when checking the formula on its cone could
+ * give a different result.
+ * \p cluster_threshold: the maximum number of nodes of a cluster of transition relations.
+ */
+smc_model_t *slice_model(smc_model_t *model, andl_context_t *andl_context, ctl_node_t *formula,
+        size_t cluster_threshold);
+
+/**
+ * Checks whether the initial state of the model satisfies \p formula. A top-level EF p or AG p is
+ * decided by searching forward from the initial state and backward from p until either search
+ * decides, unless this is disabled in the model.
+ */
+int check(smc_model_t *model, ctl_node_t *formula);
+
+/**
+ * Checks \p num_formulas normalized formulas in parallel, one Lace task per formula. Formula i is
+ * checked on \p models[i]; its outcome is stored in \p results[i], and the time it took in
+ * \p times[i].
+ */
+void check_parallel(smc_model_t **models, ctl_node_t **formulas, int num_formulas, int *results, double *times);
+
+BDD pre(smc_model_t *model, BDD states);
+BDD post(smc_model_t *model, BDD states);
 
 BDD check_BDD(smc_model_t *model, ctl_node_t *formula);
 BDD check_BDD_atom(smc_model_t *model, ctl_node_t *formula);
@@ -22,5 +121,9 @@ BDD check_BDD_disjunction(smc_model_t *model, ctl_node_t *formula);
 BDD check_BDD_EX(smc_model_t *model, ctl_node_t *formula);
 BDD check_BDD_EU(smc_model_t *model, ctl_node_t *formula);
 BDD check_BDD_EG(smc_model_t *model, ctl_node_t *formula);
+BDD check_BDD_EU_saturation(smc_model_t *model, ctl_node_t *formula);
+BDD check_BDD_EG_saturation(smc_model_t *model, ctl_node_t *formula);
+BDD check_BDD_EG_owcty(smc_model_t *model, ctl_node_t *formula);
+BDD check_BDD_EG_lockstep(smc_model_t *model, ctl_node_t *formula);
 
 #endif
\ No newline at end of file
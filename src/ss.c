@@ -1,6 +1,8 @@
 #include <config.h>
 
+#include <getopt.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <sylvan.h>
@@ -17,6 +19,16 @@
 #include "smc.h"
 
 #include "state_space.h"
+#include "reach.h"
+#include "order.h"
+#include "reduce.h"
+#include "reorder.h"
+#include "invariant.h"
+#include "ldd.h"
+#include "zdd_model.h"
+#include "explicit.h"
+#include "bitstate.h"
+#include "external.h"
 
 /**
  * Load the andl file in \p name.
@@ -61,14 +73,14 @@ load_andl(andl_context_t *andl_context, const char *name)
 }
 
 /**
- * Initializes Sylvan. The number of lace workers will be automatically
- * detected. The size of the node table, and cache are set to sensible
- * defaults. We initialize the BDD package (not LDD, or MTBDD).
+ * Initializes Sylvan. With \p n_workers 0 the number of lace workers
+ * will be automatically detected. The size of the node table, and cache
+ * are set to sensible defaults. We initialize the BDD and LDD packages
+ * (not MTBDD).
  */
 void
-init_sylvan()
+init_sylvan(int n_workers)
 {
-    int n_workers = 1; // auto-detect
     lace_init(n_workers, 40960000);
     lace_startup(0, NULL, NULL);
 
@@ -76,8 +88,9 @@ init_sylvan()
      * maximum 2^27 entries */
     sylvan_init_package(1LL<<20,1LL<<27,1LL<<20,1LL<<27);
 
-    // initialize Sylvan's BDD sub system
+    // initialize Sylvan's BDD and LDD sub systems
     sylvan_init_bdd();
+    sylvan_init_ldd();
 
     // sylvan_gc_disable();
 }
@@ -96,14 +109,10 @@ deinit_sylvan()
 }
 
 /**
- * Here you should implement whatever is required for the Software Science lab class.
- * \p andl_context: The user context that is used while parsing
- * the andl file.
- * The default implementation right now, is to print several
- * statistics of the parsed Petri net.
+ * Print the statistics of the parsed Petri net.
  */
-void
-do_ss_things(andl_context_t *andl_context)
+static void
+print_net(andl_context_t *andl_context)
 {
     warn("The name of the Petri net is: %s", andl_context->name);
     warn("There are %d transitions", andl_context->num_transitions);
@@ -111,58 +120,302 @@ do_ss_things(andl_context_t *andl_context)
     warn("There are %d in arcs", andl_context->num_in_arcs);
     warn("There are %d out arcs", andl_context->num_out_arcs);
     // warn("Current transition: %s", andl_context->current_trans);
+}
+
+/**
+ * Here you should implement whatever is required for the Software Science lab class.
+ * \p andl_context: The user context that is used while parsing
+ * the andl file.
+ * \p model: the symbolic model of the net, its reachable states are set here.
+ * \p strategy: the algorithm used to compute the reachable markings.
+ * The default implementation right now, is to print several
+ * statistics of the parsed Petri net.
+ */
+void
+do_ss_things(andl_context_t *andl_context, smc_model_t *model, reach_strategy_t strategy)
+{
+    print_net(andl_context);
+
+    // compute the reachable markings
+
+    model->reachable = reach(strategy, model->intial_state, model->transitions, model->num_transitions,
+            model->num_levels);
 
     LACE_ME;
 
-    // generate the BDDs of the initial state and relations
+    int count = mtbdd_satcount(model->reachable, model->num_levels);
+    printf("SAT count: %d\n", count);
+    printf("BDD variables: %d\n", 2 * model->num_levels);
+    printf("Nodes of the reachable states: %zu\n", sylvan_nodecount(model->reachable));
+
+    size_t filled, total;
+    sylvan_table_usage(&filled, &total);
+    printf("Node table usage: %zu of %zu\n", filled, total);
+
+    FILE *f = fopen("test.dot", "w+");
+    sylvan_fprintdot(f, model->reachable);
+    fclose(f);
+}
+
+/**
+ * The counterpart of do_ss_things for the LDD backend: computes the reachable markings of
+ * \p model, and prints the statistics to compare with the BDD backend.
+ * \return: 0 on success, 1 if the net is not bounded.
+ */
+static int
+do_ldd_things(andl_context_t *andl_context, ldd_model_t *model)
+{
+    print_net(andl_context);
+
+    if (ldd_reach(model, andl_context)) return 1;
+
+    LACE_ME;
+
+    printf("SAT count: %.0f\n", (double) lddmc_satcount(model->reachable));
+    printf("Token bound: %u\n", model->bound);
+    printf("Nodes of the reachable states: %zu\n", lddmc_nodecount(model->reachable));
+
+    size_t filled, total;
+    sylvan_table_usage(&filled, &total);
+    printf("Node table usage: %zu of %zu\n", filled, total);
+
+    return 0;
+}
+
+/*
+ * The counterpart of do_ss_things for the ZDD backend: computes the reachable markings of \p model,
+ * and prints the statistics to compare with the BDD backend.
+ */
+static void
+do_zdd_things(andl_context_t *andl_context, zdd_model_t *model)
+{
+    print_net(andl_context);
+
+    zdd_reach(model);
+
+    printf("SAT count: %.0f\n", zdd_count(model->reachable));
+    printf("Nodes of the reachable states: %zu\n", zdd_nodecount(model->reachable));
+
+    size_t filled, total;
+    zdd_table_usage(&filled, &total);
+    printf("Node table usage: %zu of %zu\n", filled, total);
+}
+
+/*
+ * The counterpart of do_ss_things for the explicit backend: computes the reachable markings of
+ * \p net in at most \p memory bytes, and prints their number and the throughput.
+ * \return: 0 on success, 1 if the memory ran out.
+ */
+static int
+do_explicit_things(andl_context_t *andl_context, explicit_net_t *net, size_t memory, explicit_stats_t *stats)
+{
+    print_net(andl_context);
+
+    int res = explicit_reach(net, memory, stats);
+
+    printf("Number of loops: %d\n", stats->levels);
+    printf("Explicit time: %.3f s\n", stats->time);
+    printf("SAT count: %llu\n", (unsigned long long) stats->states);
+    printf("Fired transitions: %llu\n", (unsigned long long) stats->transitions);
+    printf("States per second: %.0f, per core: %.0f on %d workers\n", stats->states / stats->time,
+            stats->states / stats->time / stats->workers, stats->workers);
+
+    return res;
+}
+
+/*
+ * The counterpart of do_explicit_things for the external-memory search: computes the reachable
+ * markings of \p net with files in \p directory and at most \p memory bytes of markings in memory,
+ * and prints their number and the volume and throughput of the disk traffic.
+ */
+static void
+do_external_things(andl_context_t *andl_context, explicit_net_t *net, size_t memory, const char *directory,
+        uint64_t *states)
+{
+    print_net(andl_context);
+
+    external_stats_t stats;
+    external_reach(net, memory, directory, &stats);
+
+    double io_bytes = (double) (stats.bytes_written + stats.bytes_read);
+
+    printf("Number of loops: %d\n", stats.levels);
+    printf("External time: %.3f s\n", stats.time);
+    printf("SAT count: %llu\n", (unsigned long long) stats.states);
+    printf("Fired transitions: %llu\n", (unsigned long long) stats.transitions);
+    printf("Sorted runs: %d\n", stats.runs);
+    printf("Bytes written: %llu, read: %llu\n", (unsigned long long) stats.bytes_written,
+            (unsigned long long) stats.bytes_read);
+    printf("I/O time: %.3f s, throughput: %.1f MB/s\n", stats.io_time,
+            stats.io_time > 0 ? io_bytes / stats.io_time / (1 << 20) : 0);
+    printf("States per second: %.0f\n", stats.states / stats.time);
+
+    *states = stats.states;
+}
+
+/**
+ * Print the statistics of a bitstate search.
+ */
+static void
+print_bitstate(bitstate_result_t *result)
+{
+    printf("Bitstate time: %.3f s\n", result->time);
+    printf("Visited states: %llu\n", (unsigned long long) result->states);
+    printf("Fired transitions: %llu\n", (unsigned long long) result->transitions);
+    printf("Maximum depth: %zu\n", result->max_depth);
+    printf("Bits set: %llu of %llu, with %d hash functions\n", (unsigned long long) result->bits_set,
+            (unsigned long long) result->num_bits, result->num_hashes);
+    printf("Collision probability: %.3g, estimated missed states: %.1f\n",
+            bitstate_collision_probability(result), result->omitted);
+    printf("Truncated at the depth bound: %llu\n", (unsigned long long) result->truncated);
+}
 
-    BDD init = generate_initial_state(andl_context);
-    sylvan_protect(&init);
+/*
+ * The counterpart of do_explicit_things for bitstate hashing: searches the reachable markings of
+ * \p net with a bit array of \p memory bytes, \p num_hashes hash functions and a stack of at most
+ * \p depth markings, and prints the number of markings it visited and the estimated collision
+ * probability.
+ */
+static void
+do_bitstate_things(andl_context_t *andl_context, explicit_net_t *net, size_t memory, int num_hashes, size_t depth,
+        uint64_t *states)
+{
+    print_net(andl_context);
 
-    BDD *relations = malloc(andl_context->num_transitions * sizeof(BDD));
-    BDD *vars = malloc(andl_context->num_transitions * sizeof(BDD));
+    bitstate_result_t result;
+    bitstate_search(net, memory, num_hashes, depth, NULL, 0, &result);
+
+    print_bitstate(&result);
+    *states = result.states;
+
+    free(result.trace);
+}
 
-    for (int i = 0; i < andl_context->num_transitions; i++) {
-        relations[i] = generate_relation(andl_context->transitions + i);
-        vars[i] = generate_vars(andl_context->transitions + i);
+/*
+ * \return: the markings the explicit backend searches for formula \p i: p for EF p, and not p for
+ * AG p, which holds when no reachable marking satisfies not p. Sets \p ag for AG p. For other
+ * formulas it warns that formula \p i is skipped, and returns NULL.
+ */
+static ctl_node_t *
+explicit_goal(ctl_node_t *formula, int i, int *ag)
+{
+    if ((formula->type != CTL_EF && formula->type != CTL_AG) || !explicit_is_state_formula(formula->unary.child)) {
+        warn("Formula %d is not EF or AG of a formula without temporal operators, it is skipped", i);
+        return NULL;
     }
 
-    // perform the BFS
+    *ag = formula->type == CTL_AG;
+    return *ag ? negate(formula->unary.child) : formula->unary.child;
+}
 
-    BDD map = generate_map(andl_context);
-    sylvan_protect(&map);
+/*
+ * Prints the outcome of formula \p i, AG p if \p ag and else EF p, from whether a marking of its
+ * goal was \p found. If none was found by a search that is not \p complete, the outcome is unknown,
+ * and only the one that holds unless the search missed a goal marking is printed with it.
+ */
+static void
+print_explicit_outcome(int i, int ag, int found, int complete)
+{
+    if (found || complete) {
+        printf("\nSMC outcome for formula %d: %s\n\n", i, found != ag ? "T" : "F");
+    } else {
+        printf("\nSMC outcome for formula %d: unknown (%s unless a marking was missed)\n\n", i, ag ? "T" : "F");
+    }
+}
+
+/*
+ * Checks the formulas EF p and AG p, where p has no temporal operators, by a bitstate search for a
+ * marking that satisfies p, or not p. A marking that is found is reachable, so its trace is printed
+ * as the witness of EF p or the counterexample of AG p. When no marking is found, the outcome is
+ * unknown if the search may have missed markings, by a hash collision or the depth bound. Other
+ * formulas are skipped.
+ */
+static void
+check_bitstate_formulas(andl_context_t *andl_context, explicit_net_t *net, ctl_node_t **formulas, size_t memory,
+        int num_hashes, size_t depth, int reduce)
+{
+    for (int i = 0; formulas[i] != NULL; i++) {
+        ctl_node_t *formula = formulas[i];
+
+        printf("\nformula %d\n\n", i);
 
-    BDD vOld = sylvan_set_empty();
-    BDD vNew = init;
-    sylvan_protect(&vOld);
-    sylvan_protect(&vNew);
+        print_ctl(formula);
 
-    int bfs_counter = 0;
+        int ag;
+        ctl_node_t *goal = explicit_goal(formula, i, &ag);
+        if (goal == NULL) continue;
 
-    while (vOld != vNew) {
-        vOld = vNew;
+        bitstate_result_t result;
+        bitstate_search(net, memory, num_hashes, depth, goal, reduce, &result);
 
-        for (int i = 0; i < andl_context->num_transitions; i++) {
-            BDD relprod = sylvan_exists(sylvan_and(vNew, relations[i]), vars[i]);
-            relprod = sylvan_compose(relprod, map);
+        print_bitstate(&result);
 
-            vNew = sylvan_or(vNew, relprod);
+        if (result.found) {
+            printf("%s of formula %d:", ag ? "Counterexample" : "Witness", i);
+            for (int j = 0; j < result.trace_length; j++) {
+                printf(" %s", andl_context->transitions[result.trace[j]].name);
+            }
+            printf("\n");
+        } else if (result.truncated > 0) {
+            warn("The depth bound cut off %llu markings", (unsigned long long) result.truncated);
         }
 
-        bfs_counter++;
+        print_explicit_outcome(i, ag, result.found, result.omitted == 0 && result.truncated == 0);
+
+        free(result.trace);
     }
+}
 
-    printf("Number of loops: %d\n", bfs_counter);
+/*
+ * Checks the formulas EF p and AG p, where p has no temporal operators, on the explicit backend by
+ * searching for a marking that satisfies p, or not p. With \p reduce the searches use stubborn
+ * sets, and with \p compare they are repeated without them, to report both numbers of explored
+ * states and check that the outcomes agree. Other formulas are skipped.
+ * \return: 0 on success, 1 if the outcomes with and without stubborn sets differ.
+ */
+static int
+check_explicit_formulas(explicit_net_t *net, ctl_node_t **formulas, size_t memory, int reduce, int compare)
+{
+    int res = 0;
 
-    free(relations);
-    free(vars);
+    for (int i = 0; formulas[i] != NULL; i++) {
+        ctl_node_t *formula = formulas[i];
 
-    int count = mtbdd_satcount(vNew, andl_context->num_places);
-    printf("SAT count: %d\n", count);
+        printf("\nformula %d\n\n", i);
 
-    FILE *f = fopen("test.dot", "w+");
-    sylvan_fprintdot(f, vNew);
-    fclose(f);
+        print_ctl(formula);
+
+        int ag;
+        ctl_node_t *goal = explicit_goal(formula, i, &ag);
+        if (goal == NULL) continue;
+
+        explicit_stats_t stats;
+        if (explicit_find(net, memory, goal, reduce, &stats)) {
+            warn("The markings of formula %d do not fit in memory, it has no outcome", i);
+            continue;
+        }
+
+        printf("Explored states for formula %d: %llu%s\n", i, (unsigned long long) stats.states,
+                reduce ? " with stubborn sets" : "");
+
+        if (reduce && compare) {
+            explicit_stats_t full;
+
+            if (explicit_find(net, memory, goal, 0, &full) == 0) {
+                int agree = full.found == stats.found;
+
+                printf("Explored states for formula %d: %llu without stubborn sets\n", i,
+                        (unsigned long long) full.states);
+                printf("Stubborn set cross-check: %s\n", agree ? "ok" : "MISMATCH");
+                if (!agree) res = 1;
+            }
+        }
+
+        printf("Time for formula %d: %.3f s\n", i, stats.time);
+        print_explicit_outcome(i, ag, stats.found, 1);
+    }
+
+    return res;
 }
 
 // convert a xml representation to the internal representation of the CTL formula.
@@ -181,16 +434,13 @@ ctl_node_t *parse_formula_to_ctl(xmlNode *node, andl_context_t *andl_context) {
     else if (xmlStrcmp(node->name, (const xmlChar*) "is-fireable") == 0) {
         xmlNode *transitionNode = xmlFirstElementChild(node);
 
-        ctl_node_t *atomNode = malloc(sizeof(ctl_node_t));
-        atomNode->type = CTL_ATOM;
-        atomNode->atom.num_transitions = 0;
-        atomNode->atom.fireable_transitions = NULL;
-
-        // keep track of the size of the array allocated for the transitions in this atom
+        // keep track of the transitions in this atom, and the size of the array allocated for them
+        transition_t *transitions = NULL;
+        int num_transitions = 0;
         int buf_size = 0;
 
         while (transitionNode != NULL) {
-            char* label = xmlNodeGetContent(transitionNode);
+            char* label = (char *) xmlNodeGetContent(transitionNode);
 
             //linear search the transitions for a transition with a matching name
             for (int i = 0; i < andl_context->num_transitions; i++) {
@@ -199,26 +449,26 @@ ctl_node_t *parse_formula_to_ctl(xmlNode *node, andl_context_t *andl_context) {
                 if (strcmp(andl_transition->name, label) == 0) {
                     //we found the transition with the same name!
 
-                    if (buf_size == 0) {
-                        // allocate initial buffer size
-                        buf_size = 8;
-                        atomNode->atom.fireable_transitions = malloc(sizeof(transition_t) * buf_size);
-                    } else if (buf_size == atomNode->atom.num_transitions - 1) {
+                    if (num_transitions == buf_size) {
                         // exponentially grow the buffer size
-                        buf_size *= 2;
-                        atomNode->atom.fireable_transitions = realloc(atomNode->atom.fireable_transitions,
-                                sizeof(transition_t) * buf_size);
+                        buf_size = buf_size == 0 ? 8 : buf_size * 2;
+                        transitions = realloc(transitions, sizeof(transition_t) * buf_size);
                     }
 
-                    atomNode->atom.fireable_transitions[atomNode->atom.num_transitions] = *andl_transition;
-                    atomNode->atom.num_transitions++;
+                    transitions[num_transitions] = *andl_transition;
+                    num_transitions++;
                     break;
                 }
             }
 
+            xmlFree(label);
             transitionNode = xmlNextElementSibling(transitionNode);
         }
 
+        // structurally equal atoms are shared
+        ctl_node_t *atomNode = ctl_make_atom(transitions, num_transitions);
+        free(transitions);
+
         return atomNode;
     }
     else if (xmlStrcmp(node->name, (const xmlChar*) "negation") == 0) {
@@ -416,7 +666,7 @@ static ctl_node_t **parse_xml(xmlNode *node, andl_context_t *andl_context)
     if (node == NULL) {
         warn("Invalid XML");
     // only parse xml nodes, skip other parts of the XML file.
-    } else if (node->type != XML_ELEMENT_NODE) res = parse_xml(xmlNextElementSibling(node), andl_context);
+    } else if (node->type != XML_ELEMENT_NODE) return parse_xml(xmlNextElementSibling(node), andl_context);
     // parse property-set
     else if (xmlStrcmp(node->name, (const xmlChar*) "property-set") == 0) {
         // loop over all children that are property nodes
@@ -425,12 +675,9 @@ static ctl_node_t **parse_xml(xmlNode *node, andl_context_t *andl_context)
                 property = xmlNextElementSibling(property)) {
             ctl_node_t *formula = parse_xml_property(property, andl_context);
 
-            if(buf_size == 0) {
-                buf_size = 8;
-                res = malloc(sizeof(ctl_node_t*) * buf_size);
-            } else if (num_formulas - 1 == buf_size) {
-                buf_size *= 2;
-
+            // leave room for the NULL terminator
+            if (num_formulas + 1 >= buf_size) {
+                buf_size = buf_size == 0 ? 8 : buf_size * 2;
                 res = realloc(res, sizeof(ctl_node_t*) * buf_size);
             }
 
@@ -440,6 +687,7 @@ static ctl_node_t **parse_xml(xmlNode *node, andl_context_t *andl_context)
     }
 
     // add NULL terminator
+    if (res == NULL) res = malloc(sizeof(ctl_node_t*));
     res[num_formulas] = NULL;
 
     return res;
@@ -467,6 +715,100 @@ static ctl_node_t **load_xml(const char* name, andl_context_t *andl_context)
     }
 }
 
+static void
+usage(const char *name)
+{
+    warn("Usage: %s [options] <petri-net>.andl [<CTL-formulas>.xml]", name);
+    warn("Options:");
+    warn("  -s, --strategy=<bfs|frontier|chain|sat>   reachability algorithm (default: bfs)");
+    warn("  -o, --order=<input|force|sloan|dfs|best>  static variable order (default: input)");
+    warn("      --order-file=<file>                   read the variable order from a file");
+    warn("      --save-order=<file>                   write the variable order to a file");
+    warn("  -b, --backend=<bdd|ldd|zdd|explicit>      representation of the state space (default: bdd)");
+    warn("      --bound=<k>                           initial token bound of the LDD backend (default: 1)");
+    warn("      --memory=<MB>                         memory for the markings of the explicit backend (default: 1024)");
+    warn("      --cross-check                         compare the explicit backend with the BDDs, and --por with no reduction");
+    warn("      --por                                 use stubborn sets for EF and AG formulas on the explicit backend");
+    warn("      --bitstate=<MB>                       explore by bitstate hashing in a bit array of this size on the explicit backend");
+    warn("      --hashes=<k>                          number of hash functions of bitstate hashing (default: 3)");
+    warn("      --depth=<n>                           most markings on the stack of bitstate hashing (default: 10000)");
+    warn("      --external=<dir>                      explore with the visited markings on disk in this directory, in --memory");
+    warn("  -r, --reorder=<growth>                    sift the variables when the BDDs grow by this factor");
+    warn("  -c, --cluster=<nodes>                     maximum size of a cluster of relations (default: 1000)");
+    warn("  -e, --engine=<global|sat>                 algorithm for the EU and EG fixpoints (default: sat)");
+    warn("      --eg=<el|owcty|lockstep>              algorithm for EG (default: el)");
+    warn("      --no-on-the-fly                       compute the full fixpoint for top-level EF and AG");
+    warn("      --slice                               check every formula on its cone of influence");
+    warn("      --reduce                              apply structural reductions to the net");
+    warn("      --invariants                          encode one-hot P-invariants in logarithmically many variables");
+    warn("      --restrict                            restrict the CTL fixpoints to the reachable states");
+    warn("  -w, --workers=<n>                         number of Lace workers, 0 detects the number of cores (default: 0)");
+    warn("  -p, --parallel                            check the formulas in parallel");
+}
+
+// long options without a short equivalent
+enum {
+    OPT_ORDER_FILE = 256,
+    OPT_SAVE_ORDER,
+    OPT_RESTRICT,
+    OPT_EG,
+    OPT_NO_ON_THE_FLY,
+    OPT_SLICE,
+    OPT_REDUCE,
+    OPT_INVARIANTS,
+    OPT_BOUND,
+    OPT_MEMORY,
+    OPT_CROSS_CHECK,
+    OPT_POR,
+    OPT_BITSTATE,
+    OPT_HASHES,
+    OPT_DEPTH,
+    OPT_EXTERNAL,
+};
+
+/**
+ * \brief The decision diagrams the state space is encoded in.
+ *  - BACKEND_BDD has one variable per 1-safe place, and all CTL algorithms,
+ *  - BACKEND_LDD has one integer level per place, for bounded nets with arc weights,
+ *  - BACKEND_ZDD has a node per marked place only, for 1-safe nets with few tokens,
+ *  - BACKEND_EXPLICIT stores every marking as a bit vector, for small nets that defeat BDDs.
+ */
+typedef enum {
+    BACKEND_BDD,
+    BACKEND_LDD,
+    BACKEND_ZDD,
+    BACKEND_EXPLICIT,
+} backend_t;
+
+static struct option long_options[] = {
+    { "strategy", required_argument, NULL, 's' },
+    { "order", required_argument, NULL, 'o' },
+    { "order-file", required_argument, NULL, OPT_ORDER_FILE },
+    { "save-order", required_argument, NULL, OPT_SAVE_ORDER },
+    { "backend", required_argument, NULL, 'b' },
+    { "memory", required_argument, NULL, OPT_MEMORY },
+    { "cross-check", no_argument, NULL, OPT_CROSS_CHECK },
+    { "por", no_argument, NULL, OPT_POR },
+    { "bitstate", required_argument, NULL, OPT_BITSTATE },
+    { "hashes", required_argument, NULL, OPT_HASHES },
+    { "depth", required_argument, NULL, OPT_DEPTH },
+    { "external", required_argument, NULL, OPT_EXTERNAL },
+    { "bound", required_argument, NULL, OPT_BOUND },
+    { "reorder", required_argument, NULL, 'r' },
+    { "cluster", required_argument, NULL, 'c' },
+    { "engine", required_argument, NULL, 'e' },
+    { "eg", required_argument, NULL, OPT_EG },
+    { "no-on-the-fly", no_argument, NULL, OPT_NO_ON_THE_FLY },
+    { "slice", no_argument, NULL, OPT_SLICE },
+    { "reduce", no_argument, NULL, OPT_REDUCE },
+    { "invariants", no_argument, NULL, OPT_INVARIANTS },
+    { "restrict", no_argument, NULL, OPT_RESTRICT },
+    { "workers", required_argument, NULL, 'w' },
+    { "parallel", no_argument, NULL, 'p' },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 },
+};
+
 /**
  * \brief main. First parse the .andl file is parsed. And optionally parse the
  * XML file next.
@@ -476,49 +818,444 @@ static ctl_node_t **load_xml(const char* name, andl_context_t *andl_context)
 int main(int argc, char** argv)
 {
     int res;
-    if (argc >= 2) {
+    reach_strategy_t strategy = REACH_BFS;
+    order_heuristic_t heuristic = ORDER_INPUT;
+    const char *order_file = NULL;
+    const char *save_file = NULL;
+    double growth = 0;
+    size_t cluster_threshold = 1000;
+    int restrict_reachable = 0;
+    smc_engine_t engine = SMC_SATURATION;
+    eg_algorithm_t eg = EG_EMERSON_LEI;
+    int on_the_fly = 1;
+    int slice = 0;
+    int reduce = 0;
+    int invariants = 0;
+    backend_t backend = BACKEND_BDD;
+    long bound = 1;
+    size_t memory = 1024;
+    int cross_check = 0;
+    int por = 0;
+    size_t bitstate = 0;
+    int num_hashes = 0;
+    long depth = 0;
+    const char *external = NULL;
+    int n_workers = 0;
+    int parallel = 0;
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:o:b:r:c:e:w:ph", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 's':
+                if (parse_reach_strategy(optarg, &strategy)) {
+                    warn("Unknown reachability strategy '%s'", optarg);
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'o':
+                if (parse_order_heuristic(optarg, &heuristic)) {
+                    warn("Unknown variable order '%s'", optarg);
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case OPT_ORDER_FILE:
+                order_file = optarg;
+                break;
+            case OPT_SAVE_ORDER:
+                save_file = optarg;
+                break;
+            case 'b':
+                if (strcmp(optarg, "bdd") == 0) {
+                    backend = BACKEND_BDD;
+                } else if (strcmp(optarg, "ldd") == 0) {
+                    backend = BACKEND_LDD;
+                } else if (strcmp(optarg, "zdd") == 0) {
+                    backend = BACKEND_ZDD;
+                } else if (strcmp(optarg, "explicit") == 0) {
+                    backend = BACKEND_EXPLICIT;
+                } else {
+                    warn("Unknown backend '%s'", optarg);
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case OPT_BOUND:
+                bound = atol(optarg);
+                if (bound < 1 || bound > LDD_MAX_BOUND) {
+                    warn("The token bound must be between 1 and %u", LDD_MAX_BOUND);
+                    return 1;
+                }
+                break;
+            case OPT_MEMORY:
+                memory = strtoul(optarg, NULL, 10);
+                if (memory < 1) {
+                    warn("The memory must be at least 1 MB");
+                    return 1;
+                }
+                break;
+            case OPT_CROSS_CHECK:
+                cross_check = 1;
+                break;
+            case OPT_POR:
+                por = 1;
+                break;
+            case OPT_BITSTATE:
+                bitstate = strtoul(optarg, NULL, 10);
+                if (bitstate < 1) {
+                    warn("The bit array must be at least 1 MB");
+                    return 1;
+                }
+                break;
+            case OPT_HASHES:
+                num_hashes = atoi(optarg);
+                if (num_hashes < 1 || num_hashes > 64) {
+                    warn("The number of hash functions must be between 1 and 64");
+                    return 1;
+                }
+                break;
+            case OPT_DEPTH:
+                depth = atol(optarg);
+                if (depth < 1) {
+                    warn("The depth bound must be at least 1");
+                    return 1;
+                }
+                break;
+            case OPT_EXTERNAL:
+                external = optarg;
+                break;
+            case 'r':
+                growth = atof(optarg);
+                if (growth <= 1) {
+                    warn("The reordering growth factor must be larger than 1");
+                    return 1;
+                }
+                break;
+            case 'c':
+                cluster_threshold = strtoul(optarg, NULL, 10);
+                break;
+            case 'e':
+                if (parse_smc_engine(optarg, &engine)) {
+                    warn("Unknown fixpoint engine '%s'", optarg);
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case OPT_EG:
+                if (parse_eg_algorithm(optarg, &eg)) {
+                    warn("Unknown EG algorithm '%s'", optarg);
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case OPT_NO_ON_THE_FLY:
+                on_the_fly = 0;
+                break;
+            case OPT_SLICE:
+                slice = 1;
+                break;
+            case OPT_REDUCE:
+                reduce = 1;
+                break;
+            case OPT_INVARIANTS:
+                invariants = 1;
+                break;
+            case OPT_RESTRICT:
+                restrict_reachable = 1;
+                break;
+            case 'w':
+                n_workers = atoi(optarg);
+                break;
+            case 'p':
+                parallel = 1;
+                break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                return opt != 'h';
+        }
+    }
+
+    if (backend != BACKEND_BDD && (growth > 0 || invariants || slice || parallel)) {
+        warn("--reorder, --invariants, --slice and --parallel only apply to the BDD backend");
+        growth = 0;
+        invariants = 0;
+        slice = 0;
+        parallel = 0;
+    }
+
+    if (backend != BACKEND_EXPLICIT &&
+            (cross_check || por || bitstate > 0 || num_hashes > 0 || depth > 0 || external != NULL)) {
+        warn("--cross-check, --por, --bitstate, --hashes, --depth and --external only apply to the explicit backend");
+        cross_check = 0;
+        por = 0;
+        bitstate = 0;
+        external = NULL;
+    }
+
+    if (num_hashes == 0) num_hashes = 3;
+    if (depth == 0) depth = 10000;
+
+    if (bitstate > 0 && external != NULL) {
+        warn("--bitstate and --external exclude each other");
+        return 1;
+    }
+
+    int num_args = argc - optind;
+    char **args = argv + optind;
+
+    if (num_args >= 1) {
         andl_context_t andl_context;
 
-        const char *name = argv[1];
+        const char *name = args[0];
         res = load_andl(&andl_context, name);
         if (res) warn("Unable to parse file '%s'", name);
-        else {
-            init_sylvan();
+        else if (andl_context.weighted && backend != BACKEND_LDD) {
+            warn("The net in '%s' has arc weights or markings above 1, use the LDD backend (-b ldd)", name);
+            res = 1;
+        } else {
+            if (reduce && andl_context.weighted) {
+                warn("The structural reductions only apply to 1-safe nets");
+                reduce = 0;
+            }
+
+            if (reduce) {
+                char *queried = calloc(andl_context.num_transitions + 1, 1);
+                int uses_next = 0;
+
+                // the formulas are parsed once on the full net to find the transitions they query,
+                // and parsed again on the reduced net below
+                if (num_args == 2) {
+                    ctl_node_t **ctl_formulas = load_xml(args[1], &andl_context);
+
+                    for (int i = 0; ctl_formulas != NULL && ctl_formulas[i] != NULL; i++) {
+                        reduce_mark_queried(ctl_formulas[i], queried, &uses_next);
+                    }
+
+                    ctl_free_all();
+                    free(ctl_formulas);
+                }
+
+                reduce_net(&andl_context, queried, !uses_next);
+                free(queried);
+            }
+
+            // choose the variable order before any BDD is built
+            if (order_file != NULL) {
+                if (load_order(&andl_context, order_file)) warn("Problems reading variable order '%s'", order_file);
+                warn("Loaded variable order from '%s', total span %ld", order_file, order_span(&andl_context));
+            } else {
+                order_places(&andl_context, heuristic);
+            }
+
+            if (save_file != NULL && save_order(&andl_context, save_file) == 0) {
+                warn("Saved variable order to '%s'", save_file);
+            }
+
+            // the groups are encoded at the position of their places in the chosen order
+            if (invariants) {
+                encode_invariants(&andl_context);
+
+                if (growth > 0) {
+                    warn("Dynamic reordering moves single places, it is disabled with --invariants");
+                    growth = 0;
+                }
+            }
+
+            init_sylvan(n_workers);
+            if (backend == BACKEND_ZDD) zdd_init(1 << 20);
+
+            if (growth > 0) reorder_init(&andl_context, growth);
 
             warn("Successful parse of file '%s' :)", name);
-            if (argc == 3) {
-                const char *formulas = argv[2];
+
+            // build the model once, for the reachability analysis and all formulas
+            double construction_start = wctime();
+            smc_model_t *model = NULL;
+            ldd_model_t *ldd_model = NULL;
+            zdd_model_t *zdd_model = NULL;
+            explicit_net_t *explicit_net = NULL;
+
+            if (backend == BACKEND_LDD) {
+                ldd_model = ldd_build_model(&andl_context, bound);
+            } else if (backend == BACKEND_ZDD) {
+                zdd_model = zdd_build_model(&andl_context);
+            } else if (backend == BACKEND_EXPLICIT) {
+                explicit_net = explicit_build_net(&andl_context);
+            } else {
+                model = build_model(&andl_context, cluster_threshold);
+            }
+
+            printf("Construction time: %.3f s\n", wctime() - construction_start);
+
+            // generate the whole state space and print the SAT count
+            if (ldd_model != NULL) {
+                res = do_ldd_things(&andl_context, ldd_model);
+            } else if (zdd_model != NULL) {
+                do_zdd_things(&andl_context, zdd_model);
+            } else if (explicit_net != NULL && (num_args == 1 || cross_check)) {
+                // with formulas only their goal markings are searched, unless the counts are cross-checked
+                uint64_t states;
+
+                if (bitstate > 0) {
+                    do_bitstate_things(&andl_context, explicit_net, bitstate << 20, num_hashes, depth, &states);
+                } else if (external != NULL) {
+                    do_external_things(&andl_context, explicit_net, memory << 20, external, &states);
+                } else {
+                    explicit_stats_t stats;
+                    res = do_explicit_things(&andl_context, explicit_net, memory << 20, &stats);
+                    states = stats.states;
+                }
+
+                if (res == 0 && cross_check) {
+                    model = build_model(&andl_context, cluster_threshold);
+                    do_ss_things(&andl_context, model, strategy);
+
+                    LACE_ME;
+                    double count = mtbdd_satcount(model->reachable, model->num_levels);
+
+                    if (bitstate > 0) {
+                        // bitstate hashing can only miss markings
+                        printf("States missed by bitstate hashing: %.0f\n", count - states);
+                    } else {
+                        int agree = count == (double) states;
+
+                        printf("State count cross-check: %s\n", agree ? "ok" : "MISMATCH");
+                        if (!agree) res = 1;
+                    }
+                }
+            } else if (explicit_net != NULL) {
+                print_net(&andl_context);
+            } else {
+                do_ss_things(&andl_context, model, strategy);
+
+                model->restrict_reachable = restrict_reachable;
+                model->engine = engine;
+                model->eg = eg;
+                model->on_the_fly = on_the_fly;
+            }
+
+            if (num_args == 2 && explicit_net != NULL) {
+                // every formula is a search of its own, which stops at the first goal marking
+                ctl_node_t **ctl_formulas = load_xml(args[1], &andl_context);
+
+                if (bitstate > 0) {
+                    check_bitstate_formulas(&andl_context, explicit_net, ctl_formulas, bitstate << 20, num_hashes, depth,
+                            por);
+                } else if (check_explicit_formulas(explicit_net, ctl_formulas, memory << 20, por, cross_check)) {
+                    res = 1;
+                }
+
+                ctl_free_all();
+                free(ctl_formulas);
+            } else if (num_args == 2 && res == 0) {
+                const char *formulas = args[1];
                 // load all formulas from the XML file
                 ctl_node_t **ctl_formulas = load_xml(formulas, &andl_context);
 
                 // the list of ctl formulas is NULL terminated
-                for (int i = 0; ctl_formulas[i] != NULL; i++) {
+                int num_formulas = 0;
+                while (ctl_formulas[num_formulas] != NULL) num_formulas++;
+
+                ctl_node_t **normalized = malloc((num_formulas + 1) * sizeof(ctl_node_t*));
+                smc_model_t **models = malloc((num_formulas + 1) * sizeof(smc_model_t*));
+                int *results = malloc((num_formulas + 1) * sizeof(int));
+                double *times = malloc((num_formulas + 1) * sizeof(double));
+
+                double start = wctime();
+
+                for (int i = 0; i < num_formulas; i++) {
                     ctl_node_t *formula = ctl_formulas[i];
 
                     printf("\nformula %d\n\n", i);
 
                     print_ctl(formula);
 
-                    ctl_node_t *normalized = normalize(formula);
+                    normalized[i] = normalize(formula);
 
                     printf("\nnormalized %d\n\n", i);
 
-                    print_ctl(normalized);
+                    print_ctl(normalized[i]);
 
-                    printf("\nSMC outcome for formula %d: %s\n\n", i, check(&andl_context, normalized) ? "T" : "F");
+                    int fixpoints = ctl_count_fixpoints(normalized[i]);
+                    normalized[i] = simplify(normalized[i]);
+                    int saved = fixpoints - ctl_count_fixpoints(normalized[i]);
+
+                    printf("\nsimplified %d\n\n", i);
+
+                    print_ctl(normalized[i]);
+
+                    printf("Fixpoints saved by simplification: %d of %d\n", saved, fixpoints);
+
+                    if (!parallel) {
+                        double t = wctime();
+                        models[i] = slice ? slice_model(model, &andl_context, normalized[i], cluster_threshold) : model;
+                        if (ldd_model != NULL) results[i] = ldd_check(ldd_model, normalized[i]);
+                        else if (zdd_model != NULL) results[i] = zdd_check(zdd_model, normalized[i]);
+                        else results[i] = check(models[i], normalized[i]);
+                        times[i] = wctime() - t;
+
+                        printf("\nSMC outcome for formula %d: %s\n\n", i, results[i] ? "T" : "F");
+                    }
+                }
+
+                if (parallel) {
+                    warn("Checking %d formulas in parallel on %d workers", num_formulas, lace_workers());
+
+                    for (int i = 0; i < num_formulas; i++) {
+                        models[i] = slice ? slice_model(model, &andl_context, normalized[i], cluster_threshold) : model;
+                    }
+
+                    check_parallel(models, normalized, num_formulas, results, times);
+
+                    // print the outcomes in input order
+                    for (int i = 0; i < num_formulas; i++) {
+                        printf("\nSMC outcome for formula %d: %s\n\n", i, results[i] ? "T" : "F");
+                    }
                 }
+
+                double total = 0;
+                for (int i = 0; i < num_formulas; i++) {
+                    printf("Time for formula %d: %.3f s\n", i, times[i]);
+                    total += times[i];
+                }
+
+                printf("Checking wall time: %.3f s, summed per-formula time: %.3f s\n", wctime() - start, total);
+
+                for (int i = 0; i < num_formulas; i++) {
+                    if (models[i] != model) free_model(models[i]);
+                }
+
+                free(normalized);
+                free(models);
+                free(results);
+                free(times);
+
+                ctl_report();
+                ctl_free_all();
+                free(ctl_formulas);
             }
 
-            // generate the whole state space and print the SAT count
-            do_ss_things(&andl_context);
+            if (ldd_model != NULL) {
+                ldd_free_model(ldd_model);
+            } else if (zdd_model != NULL) {
+                zdd_free_model(zdd_model);
+                zdd_quit();
+            } else if (explicit_net != NULL) {
+                explicit_free_net(explicit_net);
+            }
+
+            if (model != NULL) {
+                free_model(model);
+            }
 
             deinit_sylvan();
         }
     } else {
-        warn("Usage: %s <petri-net>.andl [<CTL-formulas>.xml]", argv[0]);
+        usage(argv[0]);
         res = 1;
     }
 
     return res;
 }
-
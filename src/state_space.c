@@ -1,7 +1,64 @@
 #include "state_space.h"
 
+#include <string.h>
+
+#include "reorder.h"
+#include "util.h"
+
+int count_levels(andl_context_t *andl_context) {
+    int num_levels = 0;
+
+    for (int i = 0; i < andl_context->num_places; i++) {
+        place_t *place = andl_context->places + i;
+        int end = place->level + (place->bits == 0 ? 1 : place->bits);
+
+        if (end > num_levels) num_levels = end;
+    }
+
+    return num_levels;
+}
+
 /*
- * Construct a BDD representing the initial state. Every place is represented with 1 variable in the BDD.
+ * Variable identifiers are 2*n for normal variables, and 2*n+1 for prime variables, where n is the
+ * level in the variable order. A place with a level of its own is marked when its variable is
+ * true; a place in a one-hot group is marked when the variables of its group hold its code.
+ */
+BDD place_marked(place_t *place, int primed) {
+    LACE_ME;
+
+    if (place->bits == 0) {
+        return sylvan_ithvar(place->level * 2 + primed);
+    }
+
+    BDD cube = sylvan_true;
+    sylvan_protect(&cube);
+
+    for (int i = place->bits - 1; i >= 0; i--) {
+        BDDVAR var = (place->level + i) * 2 + primed;
+        BDD literal = (place->code >> i) & 1 ? sylvan_ithvar(var) : sylvan_nithvar(var);
+
+        cube = sylvan_and(cube, literal);
+    }
+
+    sylvan_unprotect(&cube);
+    return cube;
+}
+
+BDD add_place_vars(BDD vars, place_t *place) {
+    LACE_ME;
+
+    int bits = place->bits == 0 ? 1 : place->bits;
+
+    for (int i = 0; i < bits; i++) {
+        vars = sylvan_set_add(vars, (place->level + i) * 2);
+        vars = sylvan_set_add(vars, (place->level + i) * 2 + 1);
+    }
+
+    return vars;
+}
+
+/*
+ * Construct a BDD representing the initial state.
  */
 BDD generate_initial_state(andl_context_t *andl_context) {
     LACE_ME;
@@ -12,14 +69,15 @@ BDD generate_initial_state(andl_context_t *andl_context) {
     for (int i = 0; i < andl_context->num_places; i++) {
         place_t *place = andl_context->places + i;
 
-        // variable identifiers are 2*n for normal variables, and 2*n+1 for prime variables.
-
-        if (place->initial_marking == 0) {
-            init = sylvan_and(init, sylvan_nithvar(place->identifier * 2));
+        if (place->bits > 0) {
+            // exactly one place of a group is marked, which fixes all variables of the group
+            if (place->initial_marking != 0) init = sylvan_and(init, place_marked(place, 0));
+        } else if (place->initial_marking == 0) {
+            init = sylvan_and(init, sylvan_nithvar(place->level * 2));
         } else {
             // assume initial marking is either 0 or 1, because 1-safe
 
-            init = sylvan_and(init, sylvan_ithvar(place->identifier * 2));
+            init = sylvan_and(init, sylvan_ithvar(place->level * 2));
         }
     }
 
@@ -39,15 +97,26 @@ BDD generate_relation(transition_t *transition) {
     for (int i = 0; i < transition->num_arcs; i++) {
         arc_t *arc = transition->arcs + i;
 
-        if (arc->dir == ARC_IN) {
+        if (arc->place->bits > 0) {
+            // the one token of a group moves from the place the transition consumes from to the
+            // place it produces in, so a transition has as many in as out arcs in every group
+            relation = sylvan_and(relation, place_marked(arc->place, arc->dir == ARC_OUT));
+
+            for (int j = 0; j < transition->num_arcs; j++) {
+                // like in the binary encoding, consuming and producing the same place never fires
+                if (transition->arcs[j].place == arc->place && transition->arcs[j].dir != arc->dir) {
+                    relation = sylvan_false;
+                }
+            }
+        } else if (arc->dir == ARC_IN) {
             // precondition
-            relation = sylvan_and(relation, sylvan_ithvar(arc->place->identifier * 2));
+            relation = sylvan_and(relation, sylvan_ithvar(arc->place->level * 2));
 
             //postcondition
-            relation = sylvan_and(relation, sylvan_nithvar(arc->place->identifier * 2 + 1));
+            relation = sylvan_and(relation, sylvan_nithvar(arc->place->level * 2 + 1));
         } else {
             // postcondition
-            relation = sylvan_and(relation, sylvan_ithvar(arc->place->identifier * 2 + 1));
+            relation = sylvan_and(relation, sylvan_ithvar(arc->place->level * 2 + 1));
         }
     }
 
@@ -56,7 +125,8 @@ BDD generate_relation(transition_t *transition) {
 }
 
 /*
- * Generate the list of variables changed in the relation corresponding to the given transition.
+ * Generate the list of variables changed in the relation corresponding to the given transition,
+ * both the normal and the primed variables of every place it touches.
  */
 BDD generate_vars(transition_t *transition) {
     LACE_ME;
@@ -66,8 +136,7 @@ BDD generate_vars(transition_t *transition) {
 
 
     for (int i = 0; i < transition->num_arcs; i++) {
-        arc_t *arc = transition->arcs + i;
-        vars = sylvan_set_add(vars, arc->place->identifier * 2);
+        vars = add_place_vars(vars, transition->arcs[i].place);
     }
 
     sylvan_unprotect(&vars);
@@ -75,20 +144,205 @@ BDD generate_vars(transition_t *transition) {
 }
 
 /*
- * Generate a map which renames all of the primed variables to the regular variables.
+ * Find the level of the top-most place the given transition touches, that is the place with the
+ * smallest level. Returns -1 for transitions without arcs.
+ */
+int generate_top(transition_t *transition) {
+    int top = -1;
+
+    for (int i = 0; i < transition->num_arcs; i++) {
+        int level = transition->arcs[i].place->level;
+
+        if (top == -1 || level < top) {
+            top = level;
+        }
+    }
+
+    return top;
+}
+
+/*
+ * Generate the relations of the transitions from up to (but excluding) to. The range is split in
+ * halves that are generated as parallel tasks. The slots in \p relations must already be protected,
+ * so that the results are visible to the garbage collector as soon as they are stored.
  */
-BDD generate_map(andl_context_t *andl_context) {
+VOID_TASK_4(generate_range, andl_context_t *, andl_context, relation_t *, relations, int, from, int, to)
+{
+    if (to - from == 1) {
+        relations[from].relation = generate_relation(andl_context->transitions + from);
+        relations[from].variables = generate_vars(andl_context->transitions + from);
+        relations[from].top = generate_top(andl_context->transitions + from);
+        return;
+    }
+
+    int mid = from + (to - from) / 2;
+
+    SPAWN(generate_range, andl_context, relations, from, mid);
+    CALL(generate_range, andl_context, relations, mid, to);
+    SYNC(generate_range);
+}
+
+/*
+ * Generate the relations of all transitions, in parallel. The BDDs are registered with
+ * reorder_protect, and should be released with free_relations.
+ */
+relation_t *generate_relations(andl_context_t *andl_context) {
     LACE_ME;
 
-    BDD map = sylvan_map_empty();
-    sylvan_protect(&map);
+    int num_transitions = andl_context->num_transitions;
+    relation_t *relations = mmalloc((num_transitions + 1) * sizeof(relation_t));
 
-    for (int i = 0; i < andl_context->num_places; i++) {
-        place_t *place = andl_context->places + i;
+    for (int i = 0; i < num_transitions; i++) {
+        relations[i].relation = sylvan_false;
+        reorder_protect(&relations[i].relation);
+
+        relations[i].variables = sylvan_set_empty();
+        reorder_protect(&relations[i].variables);
+    }
 
-        map = sylvan_map_add(map, place->identifier * 2 + 1, sylvan_ithvar(place->identifier * 2));
+    if (num_transitions > 0) {
+        // the BDDs of the workers would be missed by a reordering, and the variable order must not
+        // change while the arcs are being translated to levels
+        reorder_disable();
+        CALL(generate_range, andl_context, relations, 0, num_transitions);
+        reorder_enable();
     }
 
-    sylvan_unprotect(&map);
-    return map;
+    return relations;
+}
+
+void free_relations(relation_t *relations, int num_relations) {
+    for (int i = 0; i < num_relations; i++) {
+        reorder_unprotect(&relations[i].relation);
+        reorder_unprotect(&relations[i].variables);
+    }
+
+    free(relations);
+}
+
+/*
+ * Mark the variables of the given set in the array \p in.
+ */
+static void mark_vars(BDD set, char *in, char value) {
+    while (!sylvan_set_isempty(set)) {
+        in[sylvan_set_first(set)] = value;
+        set = sylvan_set_next(set);
+    }
+}
+
+/*
+ * The relation that keeps every place of \p set that is not marked in \p in unchanged.
+ */
+static BDD identity(BDD set, char *in) {
+    LACE_ME;
+
+    BDD result = sylvan_true;
+    sylvan_protect(&result);
+
+    while (!sylvan_set_isempty(set)) {
+        BDDVAR var = sylvan_set_first(set);
+
+        if (var % 2 == 0 && !in[var]) {
+            result = sylvan_and(result, sylvan_equiv(sylvan_ithvar(var), sylvan_ithvar(var + 1)));
+        }
+
+        set = sylvan_set_next(set);
+    }
+
+    sylvan_unprotect(&result);
+    return result;
+}
+
+static int compare_relation_top(const void *a, const void *b) {
+    return ((const relation_t *) a)->top - ((const relation_t *) b)->top;
+}
+
+/*
+ * Merge relations into a disjunctive partition. The relations are visited in order of their top
+ * level, and a relation is merged into the current cluster as long as the merged relation has at
+ * most \p threshold nodes; a threshold of 0 keeps one relation per transition. When two relations
+ * are merged, each is extended with the identity on the places only the other one touches.
+ * The BDDs of the clusters are registered with reorder_protect, and should be released with
+ * free_relations.
+ */
+relation_t *cluster_relations(relation_t *relations, int num_relations, int num_levels, size_t threshold,
+        int *num_clusters) {
+    LACE_ME;
+
+    relation_t *sorted = mmalloc((num_relations + 1) * sizeof(relation_t));
+    memcpy(sorted, relations, num_relations * sizeof(relation_t));
+    qsort(sorted, num_relations, sizeof(relation_t), compare_relation_top);
+
+    relation_t *clusters = mmalloc((num_relations + 1) * sizeof(relation_t));
+    int n = 0;
+
+    char *in_cluster = calloc(2 * num_levels + 2, 1);
+    char *in_relation = calloc(2 * num_levels + 2, 1);
+
+    BDD merged = sylvan_false;
+    sylvan_protect(&merged);
+
+    for (int i = 0; i < num_relations; i++) {
+        relation_t *relation = sorted + i;
+
+        if (n > 0 && threshold > 0) {
+            relation_t *cluster = clusters + n - 1;
+
+            mark_vars(cluster->variables, in_cluster, 1);
+            mark_vars(relation->variables, in_relation, 1);
+
+            merged = sylvan_and(cluster->relation, identity(relation->variables, in_cluster));
+            merged = sylvan_or(merged, sylvan_and(relation->relation, identity(cluster->variables, in_relation)));
+
+            mark_vars(cluster->variables, in_cluster, 0);
+            mark_vars(relation->variables, in_relation, 0);
+
+            if (sylvan_nodecount(merged) <= threshold) {
+                cluster->relation = merged;
+                cluster->variables = sylvan_set_addall(cluster->variables, relation->variables);
+                continue;
+            }
+        }
+
+        clusters[n] = *relation;
+        reorder_protect(&clusters[n].relation);
+        reorder_protect(&clusters[n].variables);
+        n++;
+    }
+
+    sylvan_unprotect(&merged);
+
+    size_t largest = 0;
+    for (int i = 0; i < n; i++) {
+        size_t size = sylvan_nodecount(clusters[i].relation);
+        if (size > largest) largest = size;
+    }
+
+    warn("Partitioned %d transitions into %d clusters, the largest has %zu nodes", num_relations, n, largest);
+
+    free(in_cluster);
+    free(in_relation);
+    free(sorted);
+
+    *num_clusters = n;
+    return clusters;
+}
+
+/*
+ * Compute the successors of the given states under a single transition relation. The relational
+ * product only visits the variables of the transition, all other places are left untouched.
+ */
+BDD image(BDD states, relation_t *relation) {
+    LACE_ME;
+
+    return sylvan_relnext(states, relation->relation, relation->variables);
+}
+
+/*
+ * Compute the predecessors of the given states under a single transition relation.
+ */
+BDD preimage(BDD states, relation_t *relation) {
+    LACE_ME;
+
+    return sylvan_relprev(relation->relation, states, relation->variables);
 }
@@ -4,12 +4,50 @@
 #ifndef STATE_SPACE_H
 #define STATE_SPACE_H
 
+/**
+ * The transition relation of a single transition, together with the set of
+ * variables it ranges over and the level of its top-most place.
+ */
+typedef struct {
+    BDD relation;
+    BDD variables;
+
+    // the smallest place level the transition touches, -1 if it has no arcs
+    int top;
+} relation_t;
+
+/**
+ * The number of levels of the encoding: one per place, or fewer when places share one-hot groups.
+ */
+int count_levels(andl_context_t *andl_context);
+
+/**
+ * The states in which \p place is marked, over the primed variables if \p primed is set.
+ */
+BDD place_marked(place_t *place, int primed);
+
+/**
+ * Adds the variables that encode \p place, both normal and primed, to \p vars.
+ */
+BDD add_place_vars(BDD vars, place_t *place);
+
 BDD generate_initial_state(andl_context_t *andl_context);
 
 BDD generate_relation(transition_t *transition);
 
 BDD generate_vars(transition_t *transition);
 
-BDD generate_map(andl_context_t *andl_context);
+int generate_top(transition_t *transition);
+
+relation_t *generate_relations(andl_context_t *andl_context);
+
+relation_t *cluster_relations(relation_t *relations, int num_relations, int num_levels, size_t threshold,
+        int *num_clusters);
+
+void free_relations(relation_t *relations, int num_relations);
+
+BDD image(BDD states, relation_t *relation);
+
+BDD preimage(BDD states, relation_t *relation);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,134 @@
+#include "stubborn.h"
+
+#include <string.h>
+
+/*
+ * The transitions of the set that still have to be closed are on a stack.
+ */
+typedef struct {
+    explicit_net_t *net;
+    const uint64_t *marking;
+    char *in_set;
+    int *stack;
+    int top;
+} closure_t;
+
+static void add(closure_t *closure, int t) {
+    if (closure->in_set[t]) return;
+
+    closure->in_set[t] = 1;
+    closure->stack[closure->top++] = t;
+}
+
+/*
+ * Add the transitions that consume from an input place of transition \p t; one of them has to fire
+ * before t is disabled.
+ */
+static void add_consumers_of_inputs(closure_t *closure, int t) {
+    explicit_net_t *net = closure->net;
+    const uint64_t *pre = net->pre + (size_t) t * net->num_words;
+
+    for (int w = 0; w < net->num_words; w++) {
+        for (uint64_t bits = pre[w]; bits != 0; bits &= bits - 1) {
+            int p = w * 64 + __builtin_ctzll(bits);
+
+            for (int i = net->consumer_start[p]; i < net->consumer_start[p + 1]; i++) {
+                add(closure, net->consumers[i]);
+            }
+        }
+    }
+}
+
+/*
+ * Add the transitions that produce in the first unmarked input place of the disabled transition
+ * \p t; one of them has to fire before t is enabled.
+ */
+static void add_producers_of_scapegoat(closure_t *closure, int t) {
+    explicit_net_t *net = closure->net;
+    const uint64_t *pre = net->pre + (size_t) t * net->num_words;
+
+    for (int w = 0; w < net->num_words; w++) {
+        uint64_t missing = pre[w] & ~closure->marking[w];
+        if (missing == 0) continue;
+
+        int p = w * 64 + __builtin_ctzll(missing);
+
+        for (int i = net->producer_start[p]; i < net->producer_start[p + 1]; i++) {
+            add(closure, net->producers[i]);
+        }
+
+        return;
+    }
+}
+
+/*
+ * Add transitions of which one has to fire before \p formula becomes \p wanted, knowing that it is
+ * not \p wanted in the current marking. Of a conjunction that has to become true, only one false
+ * conjunct has to be made true, and likewise for a disjunction that has to become false.
+ */
+static void add_interesting(closure_t *closure, ctl_node_t *formula, int wanted) {
+    explicit_net_t *net = closure->net;
+
+    switch (formula->type) {
+        case CTL_ATOM:
+            // true never becomes false
+            if (formula->atom.num_transitions == -1) return;
+
+            for (int i = 0; i < formula->atom.num_transitions; i++) {
+                int t = formula->atom.fireable_transitions[i].identifier;
+
+                if (wanted) {
+                    // all transitions are disabled, the closure adds what enables them
+                    add(closure, t);
+                } else if (explicit_enabled(net, closure->marking, t)) {
+                    // all enabled transitions have to be disabled, so one of them will do
+                    add_consumers_of_inputs(closure, t);
+                    return;
+                }
+            }
+            return;
+        case CTL_NEGATION:
+            add_interesting(closure, formula->unary.child, !wanted);
+            return;
+        case CTL_CONJUNCTION:
+        case CTL_DISJUNCTION: {
+            // a conjunction that has to become false is a disjunction that has to become true
+            int all = (formula->type == CTL_CONJUNCTION) != wanted;
+            ctl_node_t *children[2] = { formula->binary.left, formula->binary.right };
+
+            for (int i = 0; i < 2; i++) {
+                if (explicit_eval(net, children[i], closure->marking) == wanted) continue;
+
+                add_interesting(closure, children[i], wanted);
+                if (!all) return;
+            }
+            return;
+        }
+        default:
+            return;
+    }
+}
+
+int stubborn_set(explicit_net_t *net, ctl_node_t *goal, const uint64_t *marking, char *in_set, int *stack,
+        int *enabled) {
+    closure_t closure = { net, marking, in_set, stack, 0 };
+    int num_enabled = 0;
+
+    memset(in_set, 0, net->num_transitions);
+
+    add_interesting(&closure, goal, 1);
+
+    while (closure.top > 0) {
+        int t = closure.stack[--closure.top];
+
+        if (!explicit_enabled(net, marking, t)) {
+            add_producers_of_scapegoat(&closure, t);
+        } else if (net->fires[t]) {
+            // a transition that never fires does not change the marking, so it needs nothing
+            add_consumers_of_inputs(&closure, t);
+            enabled[num_enabled++] = t;
+        }
+    }
+
+    return num_enabled;
+}
@@ -0,0 +1,19 @@
+#include "explicit.h"
+
+#ifndef STUBBORN_H
+#define STUBBORN_H
+
+/**
+ * Computes a stubborn set of \p net in \p marking for reaching a marking that satisfies \p goal,
+ * which \p marking does not satisfy. The set contains transitions that can make the goal true, and
+ * is closed under the usual rules for 1-safe nets: with an enabled transition it contains the
+ * transitions that consume from its input places, and with a disabled transition the transitions
+ * that produce in one of its unmarked input places. Firing only the enabled transitions of the set
+ * preserves whether a goal marking is reachable.
+ * \p in_set and \p stack are scratch space for one entry per transition.
+ * \return: the number of enabled transitions of the set that fire, which are stored in \p enabled.
+ */
+int stubborn_set(explicit_net_t *net, ctl_node_t *goal, const uint64_t *marking, char *in_set, int *stack,
+        int *enabled);
+
+#endif
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/time.h>
 #include <time.h>
 
 #include <util.h>
@@ -42,3 +43,10 @@ rrealloc(void *ptr, size_t size) {
         exit(1);
     } else return res;
 }
+
+double
+wctime() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1E-6 * tv.tv_usec;
+}
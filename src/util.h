@@ -16,4 +16,9 @@ extern void *mmalloc(size_t size);
  * the amount of memory is not available.
  */
 extern void *rrealloc(void *ptr, size_t size);
+
+/**
+ * \brief returns the current wall clock time in seconds.
+ */
+extern double wctime();
 #endif
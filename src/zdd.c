@@ -0,0 +1,446 @@
+#include "zdd.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+/*
+ * The nodes are stored in one array, and found back through a hash table with chaining: bucket
+ * holds the first node of every chain, and next the following node. Index 0 and 1 are the
+ * terminals, so 0 also ends a chain. Free nodes are kept in a list through next as well.
+ */
+
+// the variable of the terminals, larger than every real variable
+#define TERMINAL_VAR UINT32_MAX
+
+// the size of the operation cache
+#define CACHE_SIZE (1 << 20)
+
+typedef struct {
+    uint32_t var;
+    ZDD lo;
+    ZDD hi;
+    uint32_t next;
+} zdd_node_t;
+
+typedef enum {
+    OP_UNION,
+    OP_INTERSECT,
+    OP_DIFF,
+    OP_APPLY,
+} zdd_op_t;
+
+typedef struct {
+    uint32_t op;
+    uint32_t a;
+    uint32_t b;
+    uint32_t c;
+    ZDD result;
+} zdd_cache_entry_t;
+
+static zdd_node_t *nodes;
+static size_t capacity;
+static size_t used;
+static uint32_t free_list;
+
+static uint32_t *buckets;
+static size_t num_buckets;
+
+static zdd_cache_entry_t *cache;
+
+static ZDD **roots;
+static size_t num_roots;
+static size_t roots_size;
+
+static uint32_t num_programs;
+
+static size_t hash(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    uint64_t h = a * 0x9e3779b97f4a7c15ULL;
+    h = (h ^ b) * 0xff51afd7ed558ccdULL;
+    h = (h ^ c) * 0xc4ceb9fe1a85ec53ULL;
+    h = (h ^ d) * 0x9e3779b97f4a7c15ULL;
+    return (size_t) (h ^ (h >> 29));
+}
+
+static void clear_cache() {
+    for (size_t i = 0; i < CACHE_SIZE; i++) cache[i].op = UINT32_MAX;
+}
+
+/*
+ * Rebuild the hash table and the free list, from the nodes marked in \p in_use.
+ */
+static void rebuild(const char *in_use) {
+    num_buckets = capacity;
+    buckets = rrealloc(buckets, num_buckets * sizeof(uint32_t));
+    memset(buckets, 0, num_buckets * sizeof(uint32_t));
+
+    free_list = 0;
+    used = 2;
+
+    for (size_t i = capacity - 1; i >= 2; i--) {
+        if (in_use[i]) {
+            size_t b = hash(nodes[i].var, nodes[i].lo, nodes[i].hi, 0) & (num_buckets - 1);
+            nodes[i].next = buckets[b];
+            buckets[b] = (uint32_t) i;
+            used++;
+        } else {
+            nodes[i].next = free_list;
+            free_list = (uint32_t) i;
+        }
+    }
+}
+
+/*
+ * Double the node table. \p in_use marks the nodes in use, and must have room for the new size.
+ */
+static void grow(char *in_use) {
+    memset(in_use + capacity, 0, capacity);
+
+    capacity *= 2;
+    nodes = rrealloc(nodes, capacity * sizeof(zdd_node_t));
+
+    rebuild(in_use);
+}
+
+void zdd_init(size_t initial_nodes) {
+    capacity = 1024;
+    while (capacity < initial_nodes) capacity *= 2;
+
+    nodes = mmalloc(capacity * sizeof(zdd_node_t));
+    buckets = NULL;
+    cache = mmalloc(CACHE_SIZE * sizeof(zdd_cache_entry_t));
+    clear_cache();
+
+    for (int i = 0; i < 2; i++) {
+        nodes[i].var = TERMINAL_VAR;
+        nodes[i].lo = nodes[i].hi = (ZDD) i;
+    }
+
+    char *in_use = calloc(capacity, 1);
+    rebuild(in_use);
+    free(in_use);
+
+    roots = NULL;
+    num_roots = roots_size = 0;
+    num_programs = 0;
+}
+
+void zdd_quit() {
+    free(nodes);
+    free(buckets);
+    free(cache);
+    free(roots);
+}
+
+ZDD zdd_makenode(uint32_t var, ZDD lo, ZDD hi) {
+    // zero-suppression: a variable that no set contains gets no node
+    if (hi == zdd_empty) return lo;
+
+    size_t b = hash(var, lo, hi, 0) & (num_buckets - 1);
+
+    for (uint32_t i = buckets[b]; i != 0; i = nodes[i].next) {
+        if (nodes[i].var == var && nodes[i].lo == lo && nodes[i].hi == hi) return i;
+    }
+
+    if (free_list == 0) {
+        // all nodes are in use
+        char *in_use = mmalloc(2 * capacity);
+        memset(in_use, 1, capacity);
+        grow(in_use);
+        free(in_use);
+
+        b = hash(var, lo, hi, 0) & (num_buckets - 1);
+    }
+
+    uint32_t i = free_list;
+    free_list = nodes[i].next;
+
+    nodes[i].var = var;
+    nodes[i].lo = lo;
+    nodes[i].hi = hi;
+    nodes[i].next = buckets[b];
+    buckets[b] = i;
+    used++;
+
+    return i;
+}
+
+ZDD zdd_singleton(uint32_t *vars, int num_vars) {
+    uint32_t *sorted = mmalloc((num_vars + 1) * sizeof(uint32_t));
+    memcpy(sorted, vars, num_vars * sizeof(uint32_t));
+
+    // insertion sort, the sets are small
+    for (int i = 1; i < num_vars; i++) {
+        for (int j = i; j > 0 && sorted[j - 1] > sorted[j]; j--) {
+            uint32_t t = sorted[j];
+            sorted[j] = sorted[j - 1];
+            sorted[j - 1] = t;
+        }
+    }
+
+    ZDD result = zdd_base;
+    for (int i = num_vars - 1; i >= 0; i--) result = zdd_makenode(sorted[i], zdd_empty, result);
+
+    free(sorted);
+    return result;
+}
+
+static int cache_get(zdd_op_t op, uint32_t a, uint32_t b, uint32_t c, ZDD *result) {
+    zdd_cache_entry_t *entry = cache + (hash(op, a, b, c) & (CACHE_SIZE - 1));
+
+    if (entry->op != op || entry->a != a || entry->b != b || entry->c != c) return 0;
+
+    *result = entry->result;
+    return 1;
+}
+
+static void cache_put(zdd_op_t op, uint32_t a, uint32_t b, uint32_t c, ZDD result) {
+    zdd_cache_entry_t *entry = cache + (hash(op, a, b, c) & (CACHE_SIZE - 1));
+
+    entry->op = op;
+    entry->a = a;
+    entry->b = b;
+    entry->c = c;
+    entry->result = result;
+}
+
+ZDD zdd_union(ZDD a, ZDD b) {
+    if (a == zdd_empty || a == b) return b;
+    if (b == zdd_empty) return a;
+
+    // union is commutative, so the cache only needs one order
+    if (a > b) {
+        ZDD t = a;
+        a = b;
+        b = t;
+    }
+
+    ZDD result;
+    if (cache_get(OP_UNION, a, b, 0, &result)) return result;
+
+    uint32_t va = nodes[a].var, vb = nodes[b].var;
+
+    if (va < vb) {
+        result = zdd_makenode(va, zdd_union(nodes[a].lo, b), nodes[a].hi);
+    } else if (vb < va) {
+        result = zdd_makenode(vb, zdd_union(a, nodes[b].lo), nodes[b].hi);
+    } else {
+        ZDD lo = zdd_union(nodes[a].lo, nodes[b].lo);
+        ZDD hi = zdd_union(nodes[a].hi, nodes[b].hi);
+        result = zdd_makenode(va, lo, hi);
+    }
+
+    cache_put(OP_UNION, a, b, 0, result);
+    return result;
+}
+
+ZDD zdd_intersect(ZDD a, ZDD b) {
+    if (a == zdd_empty || b == zdd_empty) return zdd_empty;
+    if (a == b) return a;
+
+    if (a > b) {
+        ZDD t = a;
+        a = b;
+        b = t;
+    }
+
+    ZDD result;
+    if (cache_get(OP_INTERSECT, a, b, 0, &result)) return result;
+
+    uint32_t va = nodes[a].var, vb = nodes[b].var;
+
+    if (va < vb) {
+        result = zdd_intersect(nodes[a].lo, b);
+    } else if (vb < va) {
+        result = zdd_intersect(a, nodes[b].lo);
+    } else {
+        ZDD lo = zdd_intersect(nodes[a].lo, nodes[b].lo);
+        ZDD hi = zdd_intersect(nodes[a].hi, nodes[b].hi);
+        result = zdd_makenode(va, lo, hi);
+    }
+
+    cache_put(OP_INTERSECT, a, b, 0, result);
+    return result;
+}
+
+ZDD zdd_diff(ZDD a, ZDD b) {
+    if (a == zdd_empty || a == b) return zdd_empty;
+    if (b == zdd_empty) return a;
+
+    ZDD result;
+    if (cache_get(OP_DIFF, a, b, 0, &result)) return result;
+
+    uint32_t va = nodes[a].var, vb = nodes[b].var;
+
+    if (va < vb) {
+        result = zdd_makenode(va, zdd_diff(nodes[a].lo, b), nodes[a].hi);
+    } else if (vb < va) {
+        result = zdd_diff(a, nodes[b].lo);
+    } else {
+        ZDD lo = zdd_diff(nodes[a].lo, nodes[b].lo);
+        ZDD hi = zdd_diff(nodes[a].hi, nodes[b].hi);
+        result = zdd_makenode(va, lo, hi);
+    }
+
+    cache_put(OP_DIFF, a, b, 0, result);
+    return result;
+}
+
+static double count(ZDD a, double *counts, char *known) {
+    if (a <= zdd_base) return a;
+    if (known[a]) return counts[a];
+
+    counts[a] = count(nodes[a].lo, counts, known) + count(nodes[a].hi, counts, known);
+    known[a] = 1;
+
+    return counts[a];
+}
+
+double zdd_count(ZDD a) {
+    double *counts = mmalloc(capacity * sizeof(double));
+    char *known = calloc(capacity, 1);
+
+    double result = count(a, counts, known);
+
+    free(counts);
+    free(known);
+    return result;
+}
+
+static size_t mark(ZDD a, char *marks) {
+    if (a <= zdd_base || marks[a]) return 0;
+
+    marks[a] = 1;
+    return 1 + mark(nodes[a].lo, marks) + mark(nodes[a].hi, marks);
+}
+
+size_t zdd_nodecount(ZDD a) {
+    char *marks = calloc(capacity, 1);
+    size_t result = mark(a, marks);
+    free(marks);
+    return result;
+}
+
+void zdd_table_usage(size_t *filled, size_t *total) {
+    *filled = used;
+    *total = capacity;
+}
+
+void zdd_protect(ZDD *zdd) {
+    if (num_roots == roots_size) {
+        roots_size = roots_size == 0 ? 64 : 2 * roots_size;
+        roots = rrealloc(roots, roots_size * sizeof(ZDD *));
+    }
+
+    roots[num_roots++] = zdd;
+}
+
+void zdd_unprotect(ZDD *zdd) {
+    // ZDDs are mostly unprotected in the reverse order they were protected in
+    for (size_t i = num_roots; i > 0; i--) {
+        if (roots[i - 1] == zdd) {
+            roots[i - 1] = roots[--num_roots];
+            return;
+        }
+    }
+}
+
+void zdd_gc_maybe() {
+    if (4 * used < 3 * capacity) return;
+
+    char *marks = calloc(2 * capacity, 1);
+    size_t live = 2;
+
+    for (size_t i = 0; i < num_roots; i++) live += mark(*roots[i], marks);
+
+    // keep enough room to avoid collecting again right away
+    if (2 * live > capacity) {
+        grow(marks);
+    } else {
+        rebuild(marks);
+    }
+
+    free(marks);
+
+    // the cache may refer to freed nodes
+    clear_cache();
+}
+
+static int compare_step(const void *a, const void *b) {
+    uint32_t va = ((const zdd_step_t *) a)->var, vb = ((const zdd_step_t *) b)->var;
+    return va < vb ? -1 : va > vb;
+}
+
+zdd_program_t zdd_make_program(zdd_step_t *steps, int num_steps) {
+    zdd_program_t program;
+    program.id = num_programs++;
+    program.num_steps = num_steps;
+    program.steps = mmalloc((num_steps + 1) * sizeof(zdd_step_t));
+
+    memcpy(program.steps, steps, num_steps * sizeof(zdd_step_t));
+    qsort(program.steps, num_steps, sizeof(zdd_step_t), compare_step);
+
+    return program;
+}
+
+void zdd_free_program(zdd_program_t *program) {
+    free(program->steps);
+}
+
+/*
+ * Apply the steps of the program from step i on. Above the variable of step i the sets are left
+ * as they are; at that variable, the sets with and without the variable are taken apart, and put
+ * together again as the action of the step says.
+ */
+static ZDD apply(ZDD a, zdd_program_t *program, int i) {
+    if (a == zdd_empty) return zdd_empty;
+    if (i == program->num_steps) return a;
+
+    ZDD result;
+    if (cache_get(OP_APPLY, a, program->id, i, &result)) return result;
+
+    zdd_step_t *step = program->steps + i;
+    uint32_t var = nodes[a].var;
+
+    if (var < step->var) {
+        ZDD lo = apply(nodes[a].lo, program, i);
+        ZDD hi = apply(nodes[a].hi, program, i);
+        result = zdd_makenode(var, lo, hi);
+    } else {
+        // the sets without and with the variable of the step
+        ZDD without = var == step->var ? nodes[a].lo : a;
+        ZDD with = var == step->var ? nodes[a].hi : zdd_empty;
+
+        switch (step->action) {
+            case ZDD_TAKE:
+                result = apply(with, program, i + 1);
+                break;
+            case ZDD_PUT: {
+                ZDD lo = apply(without, program, i + 1);
+                ZDD hi = apply(with, program, i + 1);
+                result = zdd_makenode(step->var, zdd_empty, zdd_union(lo, hi));
+                break;
+            }
+            case ZDD_UNTAKE:
+                result = zdd_makenode(step->var, zdd_empty, apply(without, program, i + 1));
+                break;
+            case ZDD_UNPUT: {
+                ZDD both = apply(with, program, i + 1);
+                result = zdd_makenode(step->var, both, both);
+                break;
+            }
+            case ZDD_REQUIRE:
+            default:
+                result = zdd_makenode(step->var, zdd_empty, apply(with, program, i + 1));
+                break;
+        }
+    }
+
+    cache_put(OP_APPLY, a, program->id, i, result);
+    return result;
+}
+
+ZDD zdd_apply(ZDD a, zdd_program_t *program) {
+    return apply(a, program, 0);
+}
@@ -0,0 +1,118 @@
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef ZDD_H
+#define ZDD_H
+
+/**
+ * A small package of zero-suppressed decision diagrams, which represent families of sets of
+ * variables. A node for variable v is left out when the sets that contain v are empty, so a set of
+ * markings of a net where few places are marked only has nodes for the marked places. Sylvan has
+ * no ZDDs, so this package keeps its own node table and operation cache. It is not thread-safe.
+ */
+typedef uint32_t ZDD;
+
+// the empty family
+#define zdd_empty ((ZDD) 0)
+
+// the family that only contains the empty set
+#define zdd_base ((ZDD) 1)
+
+// no ZDD, to mark a ZDD that is not computed yet
+#define zdd_invalid ((ZDD) UINT32_MAX)
+
+/**
+ * Initializes the package with room for \p initial_nodes nodes. The table grows when needed.
+ */
+void zdd_init(size_t initial_nodes);
+
+void zdd_quit();
+
+/**
+ * The node for \p var, with the family of sets without var in \p lo, and the family of the sets
+ * with var, var removed, in \p hi. The variables of \p lo and \p hi must be larger than \p var.
+ */
+ZDD zdd_makenode(uint32_t var, ZDD lo, ZDD hi);
+
+/**
+ * The family that only contains the set of the \p num_vars variables in \p vars.
+ */
+ZDD zdd_singleton(uint32_t *vars, int num_vars);
+
+ZDD zdd_union(ZDD a, ZDD b);
+ZDD zdd_intersect(ZDD a, ZDD b);
+ZDD zdd_diff(ZDD a, ZDD b);
+
+/**
+ * \return: the number of sets in \p a.
+ */
+double zdd_count(ZDD a);
+
+/**
+ * \return: the number of nodes of \p a, the terminals excluded.
+ */
+size_t zdd_nodecount(ZDD a);
+
+/**
+ * The number of nodes in use, and the size of the node table.
+ */
+void zdd_table_usage(size_t *filled, size_t *total);
+
+/**
+ * Protects the ZDD stored in \p zdd from garbage collection, until zdd_unprotect.
+ */
+void zdd_protect(ZDD *zdd);
+
+void zdd_unprotect(ZDD *zdd);
+
+/**
+ * Collects the garbage when the node table fills up. Garbage is only ever collected here, so
+ * every ZDD that is still needed after this call must be protected.
+ */
+void zdd_gc_maybe();
+
+/**
+ * \brief What a step of a program does with its variable, in every set of a family:
+ *  - ZDD_TAKE keeps the sets with the variable, and removes it,
+ *  - ZDD_PUT adds the variable to all sets,
+ *  - ZDD_UNTAKE keeps the sets without the variable, and adds it; it undoes ZDD_TAKE,
+ *  - ZDD_UNPUT keeps the sets with the variable, both with and without it; it undoes ZDD_PUT,
+ *  - ZDD_REQUIRE keeps the sets with the variable.
+ */
+typedef enum {
+    ZDD_TAKE,
+    ZDD_PUT,
+    ZDD_UNTAKE,
+    ZDD_UNPUT,
+    ZDD_REQUIRE,
+} zdd_action_t;
+
+typedef struct {
+    uint32_t var;
+    zdd_action_t action;
+} zdd_step_t;
+
+/**
+ * A list of steps in increasing order of their variables, applied to a family in one pass.
+ */
+typedef struct {
+    // identifies the program in the operation cache
+    uint32_t id;
+
+    zdd_step_t *steps;
+    int num_steps;
+} zdd_program_t;
+
+/**
+ * Makes a program of the \p num_steps \p steps, which are copied and sorted by variable.
+ */
+zdd_program_t zdd_make_program(zdd_step_t *steps, int num_steps);
+
+void zdd_free_program(zdd_program_t *program);
+
+/**
+ * Applies \p program to all sets in \p a.
+ */
+ZDD zdd_apply(ZDD a, zdd_program_t *program);
+
+#endif
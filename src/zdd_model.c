@@ -0,0 +1,301 @@
+#include "zdd_model.h"
+
+#include <stdlib.h>
+
+#include "util.h"
+
+/*
+ * Generate the programs of one transition from its arcs. The image takes the token of every input
+ * place and puts one in every output place; the pre-image undoes both, so the input places are
+ * empty after firing and were marked before, and the output places were marked or empty.
+ */
+static void generate_zdd_transition(transition_t *transition, zdd_transition_t *result) {
+    zdd_step_t *image = mmalloc((transition->num_arcs + 1) * sizeof(zdd_step_t));
+    zdd_step_t *preimage = mmalloc((transition->num_arcs + 1) * sizeof(zdd_step_t));
+    zdd_step_t *enabled = mmalloc((transition->num_arcs + 1) * sizeof(zdd_step_t));
+    int n = 0, num_enabled = 0;
+
+    result->fires = 1;
+
+    for (int i = 0; i < transition->num_arcs; i++) {
+        arc_t *arc = transition->arcs + i;
+        uint32_t var = arc->place->level;
+        int duplicate = 0;
+
+        for (int j = 0; j < n; j++) {
+            if (image[j].var != var) continue;
+
+            duplicate = 1;
+            if ((image[j].action == ZDD_TAKE) != (arc->dir == ARC_IN)) result->fires = 0;
+        }
+
+        // like check_BDD_atom, the transition is enabled when its input places are marked, even if
+        // it never fires
+        if (arc->dir == ARC_IN) {
+            int known = 0;
+            for (int j = 0; j < num_enabled; j++) known |= enabled[j].var == var;
+
+            if (!known) {
+                enabled[num_enabled].var = var;
+                enabled[num_enabled].action = ZDD_REQUIRE;
+                num_enabled++;
+            }
+        }
+
+        if (duplicate) continue;
+
+        image[n].var = preimage[n].var = var;
+
+        if (arc->dir == ARC_IN) {
+            image[n].action = ZDD_TAKE;
+            preimage[n].action = ZDD_UNTAKE;
+        } else {
+            image[n].action = ZDD_PUT;
+            preimage[n].action = ZDD_UNPUT;
+        }
+
+        n++;
+    }
+
+    result->image = zdd_make_program(image, n);
+    result->preimage = zdd_make_program(preimage, n);
+    result->enabled = zdd_make_program(enabled, num_enabled);
+
+    free(image);
+    free(preimage);
+    free(enabled);
+}
+
+zdd_model_t *zdd_build_model(andl_context_t *andl_context) {
+    zdd_model_t *model = mmalloc(sizeof(zdd_model_t));
+
+    uint32_t *marked = mmalloc((andl_context->num_places + 1) * sizeof(uint32_t));
+    int num_marked = 0;
+
+    for (int i = 0; i < andl_context->num_places; i++) {
+        if (andl_context->places[i].initial_marking != 0) marked[num_marked++] = andl_context->places[i].level;
+    }
+
+    model->initial_state = zdd_singleton(marked, num_marked);
+    zdd_protect(&model->initial_state);
+    free(marked);
+
+    model->num_transitions = andl_context->num_transitions;
+    model->transitions = mmalloc((model->num_transitions + 1) * sizeof(zdd_transition_t));
+
+    for (int i = 0; i < model->num_transitions; i++) {
+        generate_zdd_transition(andl_context->transitions + i, model->transitions + i);
+    }
+
+    model->reachable = zdd_empty;
+    zdd_protect(&model->reachable);
+
+    return model;
+}
+
+void zdd_free_model(zdd_model_t *model) {
+    zdd_unprotect(&model->initial_state);
+    zdd_unprotect(&model->reachable);
+
+    for (int i = 0; i < model->num_transitions; i++) {
+        zdd_free_program(&model->transitions[i].image);
+        zdd_free_program(&model->transitions[i].preimage);
+        zdd_free_program(&model->transitions[i].enabled);
+    }
+
+    free(model->transitions);
+    free(model);
+}
+
+/*
+ * Chaining, like reach_chaining on BDDs: the output of every transition is fed to the next
+ * transition within the same iteration.
+ */
+void zdd_reach(zdd_model_t *model) {
+    ZDD visited = model->initial_state;
+    ZDD frontier = visited;
+    ZDD chain = zdd_empty;
+    zdd_protect(&visited);
+    zdd_protect(&frontier);
+    zdd_protect(&chain);
+
+    int counter = 0;
+    double start = wctime();
+
+    while (frontier != zdd_empty) {
+        double t = wctime();
+
+        chain = frontier;
+
+        for (int i = 0; i < model->num_transitions; i++) {
+            if (!model->transitions[i].fires) continue;
+
+            ZDD next = zdd_apply(chain, &model->transitions[i].image);
+            chain = zdd_union(chain, zdd_diff(next, visited));
+        }
+
+        frontier = zdd_diff(chain, visited);
+        visited = zdd_union(visited, frontier);
+
+        counter++;
+
+        warn("ZDD chaining iteration %d: %.3f s, %.0f new states, %zu nodes in the frontier",
+                counter, wctime() - t, zdd_count(frontier), zdd_nodecount(frontier));
+
+        zdd_gc_maybe();
+    }
+
+    printf("Number of loops: %d\n", counter);
+    printf("Chaining time: %.3f s\n", wctime() - start);
+
+    model->reachable = visited;
+
+    zdd_unprotect(&visited);
+    zdd_unprotect(&frontier);
+    zdd_unprotect(&chain);
+}
+
+int zdd_check(zdd_model_t *model, ctl_node_t *formula) {
+    return zdd_diff(model->initial_state, check_ZDD(model, formula)) == zdd_empty;
+}
+
+/*
+ * Compute the reachable predecessors of the given states, as the union of the predecessors under
+ * every transition. The pre-image does not know whether the output places were marked before, so
+ * it gives both, and the unreachable ones are left out.
+ */
+ZDD zdd_pre(zdd_model_t *model, ZDD states) {
+    ZDD result = zdd_empty;
+
+    for (int i = 0; i < model->num_transitions; i++) {
+        if (!model->transitions[i].fires) continue;
+
+        result = zdd_union(result, zdd_apply(states, &model->transitions[i].preimage));
+    }
+
+    return zdd_intersect(result, model->reachable);
+}
+
+ZDD check_ZDD(zdd_model_t *model, ctl_node_t *formula) {
+    // formulas are shared between all formulas of a run, so their result may already be known
+    if (formula->zdd_result != zdd_invalid) {
+        return formula->zdd_result;
+    }
+
+    ZDD result;
+
+    switch (formula->type) {
+        case CTL_ATOM:
+            result = check_ZDD_atom(model, formula);
+            break;
+        case CTL_NEGATION:
+            result = check_ZDD_negation(model, formula);
+            break;
+        case CTL_CONJUNCTION:
+            result = check_ZDD_conjunction(model, formula);
+            break;
+        case CTL_DISJUNCTION:
+            result = check_ZDD_disjunction(model, formula);
+            break;
+        case CTL_EX:
+            result = check_ZDD_EX(model, formula);
+            break;
+        case CTL_EU:
+            result = check_ZDD_EU(model, formula);
+            break;
+        case CTL_EG:
+            result = check_ZDD_EG(model, formula);
+            break;
+        default:
+            printf("Unknown case in check_ZDD\n");
+            return zdd_empty;
+    }
+
+    formula->zdd_result = result;
+    zdd_protect(&formula->zdd_result);
+
+    return result;
+}
+
+ZDD check_ZDD_atom(zdd_model_t *model, ctl_node_t *formula) {
+    // -1 marks true value
+    if (formula->atom.num_transitions == -1) return model->reachable;
+
+    ZDD result = zdd_empty;
+
+    for (int i = 0; i < formula->atom.num_transitions; i++) {
+        zdd_transition_t *transition = model->transitions + formula->atom.fireable_transitions[i].identifier;
+
+        result = zdd_union(result, zdd_apply(model->reachable, &transition->enabled));
+    }
+
+    return result;
+}
+
+ZDD check_ZDD_negation(zdd_model_t *model, ctl_node_t *formula) {
+    return zdd_diff(model->reachable, check_ZDD(model, formula->unary.child));
+}
+
+ZDD check_ZDD_conjunction(zdd_model_t *model, ctl_node_t *formula) {
+    ZDD left = check_ZDD(model, formula->binary.left);
+    ZDD right = check_ZDD(model, formula->binary.right);
+
+    return zdd_intersect(left, right);
+}
+
+ZDD check_ZDD_disjunction(zdd_model_t *model, ctl_node_t *formula) {
+    ZDD left = check_ZDD(model, formula->binary.left);
+    ZDD right = check_ZDD(model, formula->binary.right);
+
+    return zdd_union(left, right);
+}
+
+ZDD check_ZDD_EX(zdd_model_t *model, ctl_node_t *formula) {
+    return zdd_pre(model, check_ZDD(model, formula->unary.child));
+}
+
+/*
+ * E[a U b] as a backward search from b through a, that only takes the pre-image of the states
+ * found in the previous iteration.
+ */
+ZDD check_ZDD_EU(zdd_model_t *model, ctl_node_t *formula) {
+    ZDD a = check_ZDD(model, formula->binary.left);
+    ZDD b = check_ZDD(model, formula->binary.right);
+
+    ZDD result = b;
+    ZDD frontier = b;
+    zdd_protect(&result);
+    zdd_protect(&frontier);
+
+    while (frontier != zdd_empty) {
+        frontier = zdd_diff(zdd_intersect(zdd_pre(model, frontier), a), result);
+        result = zdd_union(result, frontier);
+
+        zdd_gc_maybe();
+    }
+
+    zdd_unprotect(&result);
+    zdd_unprotect(&frontier);
+
+    return result;
+}
+
+/*
+ * EG a as the greatest fixpoint of Z = a and EX Z.
+ */
+ZDD check_ZDD_EG(zdd_model_t *model, ctl_node_t *formula) {
+    ZDD z = check_ZDD(model, formula->unary.child);
+    ZDD old = zdd_invalid;
+    zdd_protect(&z);
+
+    while (z != old) {
+        old = z;
+        z = zdd_intersect(z, zdd_pre(model, z));
+
+        zdd_gc_maybe();
+    }
+
+    zdd_unprotect(&z);
+
+    return z;
+}
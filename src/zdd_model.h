@@ -0,0 +1,67 @@
+#include "andl.h"
+#include "ctl.h"
+#include "zdd.h"
+
+#ifndef ZDD_MODEL_H
+#define ZDD_MODEL_H
+
+/**
+ * The programs of a single transition of a 1-safe net, see zdd.h. A marking is the set of its
+ * marked places, identified by their level.
+ */
+typedef struct {
+    // whether the transition can fire at all; like the BDD encoding, a transition that consumes
+    // from and produces in the same place never fires
+    int fires;
+
+    // takes the tokens of the input places and puts tokens in the output places
+    zdd_program_t image;
+
+    // the reverse of image
+    zdd_program_t preimage;
+
+    // requires the tokens of the input places
+    zdd_program_t enabled;
+} zdd_transition_t;
+
+/**
+ * The model of a 1-safe Petri net on ZDDs. Only the marked places of a marking have nodes, so the
+ * sets of markings of nets with few tokens are small.
+ */
+typedef struct {
+    ZDD initial_state;
+
+    zdd_transition_t *transitions;
+    int num_transitions;
+
+    // the reachable states, the universe of all formulas; zdd_empty until they are computed
+    ZDD reachable;
+} zdd_model_t;
+
+zdd_model_t *zdd_build_model(andl_context_t *andl_context);
+
+void zdd_free_model(zdd_model_t *model);
+
+/**
+ * Computes the reachable states of \p model by chaining.
+ */
+void zdd_reach(zdd_model_t *model);
+
+/**
+ * Checks whether the initial state of the model satisfies the normalized \p formula, on the
+ * reachable states computed by zdd_reach.
+ */
+int zdd_check(zdd_model_t *model, ctl_node_t *formula);
+
+ZDD zdd_pre(zdd_model_t *model, ZDD states);
+
+ZDD check_ZDD(zdd_model_t *model, ctl_node_t *formula);
+ZDD check_ZDD_atom(zdd_model_t *model, ctl_node_t *formula);
+ZDD check_ZDD_negation(zdd_model_t *model, ctl_node_t *formula);
+ZDD check_ZDD_conjunction(zdd_model_t *model, ctl_node_t *formula);
+ZDD check_ZDD_disjunction(zdd_model_t *model, ctl_node_t *formula);
+ZDD check_ZDD_EX(zdd_model_t *model, ctl_node_t *formula);
+ZDD check_ZDD_EU(zdd_model_t *model, ctl_node_t *formula);
+ZDD check_ZDD_EG(zdd_model_t *model, ctl_node_t *formula);
+
+#endif